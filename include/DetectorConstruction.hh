@@ -8,6 +8,9 @@
 #include "G4Box.hh"
 #include "G4Tubs.hh"
 #include "G4PVPlacement.hh"
+#include "G4ThreeVector.hh"
+
+class DetectorMessenger;
 
 class DetectorConstruction : public G4VUserDetectorConstruction
 {
@@ -18,9 +21,22 @@ public:
     virtual G4VPhysicalVolume* Construct();
     virtual void ConstructSDandField();
     
+    // 房间几何设置 (需在 /run/initialize 之前调用)
+    void SetGdmlFile(const G4String& fileName);
+    void SetDetectorPosition(const G4ThreeVector& pos);
+    void SetSmartless(G4double value);
+    void SetTessellatedMaxVoxels(G4int value);
+    
+    // 随机射线导航测试, 输出 steps/sec
+    void BenchmarkNavigation(G4int nRays);
+    
 private:
     void DefineMaterials();
     void SetupGeometry();
+    G4VPhysicalVolume* ConstructDefaultRoom();
+    G4VPhysicalVolume* ConstructGdmlRoom();
+    void PlaceDetector(G4LogicalVolume* motherLog);
+    void TuneVoxelisation();
     
     // 材料
     G4Material* air;
@@ -35,6 +51,13 @@ private:
     G4double roomSizeX, roomSizeY, roomSizeZ;
     G4double naiRadius, naiHeight;
     G4double canThickness;
+    
+    // 房间导入与导航参数
+    G4String gdmlFile;
+    G4ThreeVector detectorPosition;
+    G4double smartless;
+    G4int tessellatedMaxVoxels;
+    DetectorMessenger* fMessenger;
 };
 
 #endif
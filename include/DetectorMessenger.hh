@@ -0,0 +1,32 @@
+#ifndef DETECTOR_MESSENGER_HH
+#define DETECTOR_MESSENGER_HH
+
+#include "G4UImessenger.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithADouble.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4UIcmdWith3VectorAndUnit.hh"
+#include "globals.hh"
+
+class DetectorConstruction;
+
+class DetectorMessenger : public G4UImessenger
+{
+public:
+    DetectorMessenger(DetectorConstruction* detector);
+    virtual ~DetectorMessenger();
+    
+    virtual void SetNewValue(G4UIcommand* command, G4String newValue);
+    
+private:
+    DetectorConstruction* fDetector;
+    G4UIdirectory* fDetDir;
+    G4UIcmdWithAString* fGdmlFileCmd;           // 房间GDML文件
+    G4UIcmdWith3VectorAndUnit* fDetectorPosCmd; // 探测器位置
+    G4UIcmdWithADouble* fSmartlessCmd;          // 智能体素参数
+    G4UIcmdWithAnInteger* fMaxVoxelsCmd;        // 三角网格体素上限
+    G4UIcmdWithAnInteger* fBenchmarkCmd;        // 导航性能测试
+};
+
+#endif
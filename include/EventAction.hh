@@ -4,6 +4,7 @@
 #include "G4UserEventAction.hh"
 #include "G4Event.hh"
 #include "globals.hh"
+#include <chrono>
 
 class RunAction;
 
@@ -17,11 +18,17 @@ public:
     virtual void EndOfEventAction(const G4Event* event);
 
     void AddEdep(G4double edep) { fTotalEdep += edep; }
+    void CountStep() { fNSteps++; }
     void SetHitPosition(const G4ThreeVector& pos);  
 
 private:
     G4double fTotalEdep;
     RunAction* fRunAction;
+    
+    // 慢事件统计
+    G4long fNSteps;
+    std::chrono::steady_clock::time_point fStartTime;
+    long fRngSeeds[2];  // 事件开始时的随机数引擎种子
 };
 
 #endif
@@ -5,8 +5,12 @@
 #include "G4ParticleGun.hh"
 #include "G4Event.hh"
 #include "G4SystemOfUnits.hh"
+#include <vector>
 
 class PrimaryGeneratorMessenger;
+class G4ParticleDefinition;
+class G4Navigator;
+class G4VPhysicalVolume;
 
 class PrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
 {
@@ -18,18 +22,55 @@ public:
     
     void SetCs137Activity(G4double activity);
     void SetTestMode(G4bool mode);  // 添加测试模式设置
+    void SetBatchSize(G4int size);  // 0: 逐个事件使用G4ParticleGun
     G4double GetCs137Activity() const;
+    G4double GetRoomVolume() const { return roomVolume; }  // 源所在空气体积, m3
+    
+    // 源抽样区域取自当前世界体积: 包围盒内、不在任何子体积 (墙体、家具、探测器) 中的点
+    void UpdateSourceRegion();
+    void GetSourceRegion(G4ThreeVector& lower, G4ThreeVector& upper) const;
+    
+    // 比较逐个生成与批量生成的 primaries/sec
+    void BenchmarkPrimaries(G4int nPrimaries);
+    
+    // 下一个事件重放记录的初级粒子, 并恢复其跟踪开始时的随机数状态
+    void SetReplayEvent(const G4ThreeVector& vertex, const G4ThreeVector& direction,
+                        G4double energy, const long* rngSeeds);
     
 private:
     G4ParticleGun* particleGun;
+    G4ParticleDefinition* fGamma;  // 缓存粒子定义, 避免每个事件查表
     G4double cs137Activity;
     G4double roomVolume;
     G4bool testMode;  // 测试模式标志
     PrimaryGeneratorMessenger* fMessenger;
     
+    // 源抽样区域
+    G4VPhysicalVolume* fSourceWorld;
+    G4Navigator* fSourceNavigator;  // 独立导航器, 不干扰跟踪
+    G4ThreeVector fSourceLower, fSourceUpper;
+    G4ThreeVector fDetectorPosition;
+    
+    // 批量生成的顶点与方向 (结构数组)
+    G4int fBatchSize;
+    size_t fBlockIndex;
+    std::vector<G4double> fRandoms;
+    std::vector<G4double> fBlockX, fBlockY, fBlockZ;
+    std::vector<G4double> fBlockU, fBlockV, fBlockW;
+    
+    // 慢事件重放
+    G4bool fReplayPending;
+    G4ThreeVector fReplayVertex, fReplayDirection;
+    G4double fReplayEnergy;
+    long fReplayRngSeeds[2];
+    
     void GenerateCs137Decay(G4Event* event);
     void GenerateGamma662(G4Event* event);
+    void GenerateGamma662Batched(G4Event* event);
     void GenerateTestGamma(G4Event* event);  // 测试模式生成函数
+    void GenerateReplayGamma(G4Event* event);
+    void FillBlock();
+    G4bool IsSourcePoint(const G4ThreeVector& pos);
 };
 
 #endif
@@ -5,6 +5,7 @@
 #include "G4UIdirectory.hh"
 #include "G4UIcmdWithADouble.hh"
 #include "G4UIcmdWithABool.hh"  // 添加布尔命令
+#include "G4UIcmdWithAnInteger.hh"
 #include "globals.hh"
 
 class PrimaryGeneratorAction;
@@ -22,6 +23,8 @@ private:
     G4UIdirectory* fGunDir;
     G4UIcmdWithADouble* fCs137ActivityCmd;
     G4UIcmdWithABool* fTestModeCmd;  // 测试模式命令
+    G4UIcmdWithAnInteger* fBatchSizeCmd;  // 批量生成块大小
+    G4UIcmdWithAnInteger* fBenchmarkCmd;  // 生成速度测试
 };
 
 #endif
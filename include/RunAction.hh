@@ -3,8 +3,12 @@
 
 #include "G4UserRunAction.hh"
 #include "globals.hh"
+#include "SpectrumAccumulator.hh"
+#include "SourceResponseMap.hh"
+#include "SlowEventProfiler.hh"
 
 class G4Run;
+class RunMessenger;
 
 class RunAction : public G4UserRunAction
 {
@@ -16,11 +20,43 @@ public:
     virtual void EndOfRunAction(const G4Run*);
     
     void GenerateSpectrumData();
+    void AnalyseSpectrum(G4int nofEvents);
     void AddEnergyDeposit(G4double edep);
+    void FillSpectrum(G4double edep) { fSpectrum.Fill(edep); }
+    
+    const SpectrumAccumulator& GetSpectrum() const { return fSpectrum; }
+    
+    // 源体素响应记录
+    void SetResponseMapEnabled(G4bool enable);
+    void SetResponseMapGrid(G4int nx, G4int ny, G4int nz);
+    G4bool IsResponseMapEnabled() const { return fResponseMapEnabled; }
+    void RecordSourceResponse(const G4ThreeVector& vertex, G4double edep)
+    {
+        fResponseMap.Record(fResponseMap.FindVoxel(vertex), edep);
+    }
+    
+    // 慢事件统计与重放
+    void SetProfilerEnabled(G4bool enable);
+    void SetProfilerTopK(G4int k) { fProfiler.SetTopK(k); }
+    G4bool IsProfilerEnabled() const { return fProfilerEnabled; }
+    G4bool IsReplaying() const { return fReplaying; }
+    SlowEventProfiler& GetProfiler() { return fProfiler; }
+    void ReplayEvent(G4int eventID);
+    
+    // 662 keV峰名义FWHM: 模拟能谱未展宽时用于确定ROI宽度
+    void SetNominalFWHM(G4double fwhm) { fNominalFWHM = fwhm; }
     
 private:
     G4double totalEnergyDeposit;
     G4int numEvents;
+    SpectrumAccumulator fSpectrum;  // 本线程能谱计数
+    SourceResponseMap fResponseMap;
+    G4bool fResponseMapEnabled;
+    SlowEventProfiler fProfiler;
+    G4bool fProfilerEnabled;
+    G4bool fReplaying;  // 重放运行不输出文件, 不重置统计
+    G4double fNominalFWHM;
+    RunMessenger* fMessenger;
 };
 
 #endif
@@ -0,0 +1,36 @@
+#ifndef RUN_MESSENGER_HH
+#define RUN_MESSENGER_HH
+
+#include "G4UImessenger.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcommand.hh"
+#include "G4UIcmdWithABool.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include "globals.hh"
+
+class RunAction;
+
+class RunMessenger : public G4UImessenger
+{
+public:
+    RunMessenger(RunAction* action);
+    virtual ~RunMessenger();
+    
+    virtual void SetNewValue(G4UIcommand* command, G4String newValue);
+    
+private:
+    RunAction* fAction;
+    G4UIdirectory* fNaIDir;
+    G4UIdirectory* fResponseMapDir;
+    G4UIcmdWithABool* fResponseMapCmd;   // 源体素响应记录开关
+    G4UIcommand* fResponseGridCmd;       // 体素网格
+    G4UIdirectory* fProfilerDir;
+    G4UIcmdWithABool* fProfilerCmd;      // 慢事件统计开关
+    G4UIcmdWithAnInteger* fTopKCmd;      // 最慢事件表长度
+    G4UIcmdWithAnInteger* fReplayCmd;    // 重放慢事件
+    G4UIdirectory* fAnalysisDir;
+    G4UIcmdWithADoubleAndUnit* fNominalFWHMCmd;  // 名义FWHM (ROI宽度)
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef SLOW_EVENT_PROFILER_HH
+#define SLOW_EVENT_PROFILER_HH
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+#include <vector>
+
+// 慢事件记录: 重放所需的随机数状态和初级粒子
+struct SlowEventRecord
+{
+    G4int eventID;
+    G4double wallTime;        // s
+    G4long steps;
+    long rngSeeds[2];         // 事件开始 (跟踪前) 的 Ranecu 引擎种子对
+    G4ThreeVector vertex;
+    G4ThreeVector direction;
+    G4double energy;
+};
+
+// 每事件耗时统计 + 最慢 K 个事件表
+class SlowEventProfiler
+{
+public:
+    SlowEventProfiler();
+    ~SlowEventProfiler();
+    
+    void SetTopK(G4int k) { fTopK = k; }
+    void Reset();
+    
+    // 记录一个事件的耗时; 返回 true 表示该事件进入最慢表, 需调用 Insert
+    G4bool AddEvent(G4double wallTime);
+    void Insert(const SlowEventRecord& record);
+    
+    const SlowEventRecord* Find(G4int eventID) const;
+    void Print() const;
+    void Write(const G4String& fileName) const;
+    
+private:
+    G4double Percentile(G4double fraction) const;
+    
+    G4int fTopK;
+    std::vector<SlowEventRecord> fSlowest;   // 按耗时的最小堆
+    
+    // 耗时对数直方图 (1 µs - 100 s, 每十倍20道), 用于分位数
+    std::vector<G4long> fTimeHistogram;
+    G4long fNEvents;
+    G4double fTotalTime;
+    G4double fMaxTime;
+};
+
+#endif
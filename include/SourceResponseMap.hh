@@ -0,0 +1,45 @@
+#ifndef SOURCE_RESPONSE_MAP_HH
+#define SOURCE_RESPONSE_MAP_HH
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+#include <unordered_map>
+#include <vector>
+
+// 源体素 × 能量道 的稀疏响应计数.
+// 每个事件记录源顶点所在体素的发射数, 以及探测器沉积能量所在道;
+// 任意活度分布的能谱可由 reweight_spectrum.py 离线加权得到.
+class SourceResponseMap
+{
+public:
+    SourceResponseMap();
+    ~SourceResponseMap();
+    
+    void SetGrid(G4int nx, G4int ny, G4int nz);
+    void SetExtent(const G4ThreeVector& lower, const G4ThreeVector& upper);
+    void SetSourceVolume(G4double volume) { fSourceVolume = volume; }  // 网格内实际抽样的空气体积
+    void SetEnergyBinning(G4double low, G4double high, G4int nBins);
+    void Reset();
+    
+    // 源顶点所在体素号, 网格外返回 -1
+    G4int FindVoxel(const G4ThreeVector& pos) const;
+    void Record(G4int voxel, G4double edep);
+    
+    void Write(const G4String& voxelFileName, const G4String& mapFileName) const;
+    
+    G4int GetNx() const { return fNx; }
+    G4int GetNy() const { return fNy; }
+    G4int GetNz() const { return fNz; }
+    
+private:
+    G4int fNx, fNy, fNz;
+    G4ThreeVector fLower, fUpper;
+    G4double fSourceVolume;
+    G4double fEnergyLow, fEnergyInvWidth;
+    G4int fEnergyBins;
+    
+    std::vector<G4long> fEmitted;                    // 每个体素的发射数
+    std::unordered_map<G4long, G4long> fTally;       // 键: voxel * fEnergyBins + bin
+};
+
+#endif
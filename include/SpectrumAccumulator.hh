@@ -0,0 +1,45 @@
+#ifndef SPECTRUM_ACCUMULATOR_HH
+#define SPECTRUM_ACCUMULATOR_HH
+
+#include "globals.hh"
+#include <vector>
+
+// 轻量能谱计数器: 连续整数数组, 每个事件只计算一次细分道号.
+// 全谱、放大谱和重分道能谱都由细分道合并得到 (GetView).
+// 仅用于顺序 G4RunManager: 单一实例, 无需跨线程归约.
+class SpectrumAccumulator
+{
+public:
+    SpectrumAccumulator(G4double low, G4double high, G4int nFineBins);
+    ~SpectrumAccumulator();
+    
+    inline void Fill(G4double energy)
+    {
+        G4double x = (energy - fLow) * fInvWidth;
+        if (x >= 0. && x < fNBins) {
+            ++fCounts[(size_t)x];
+        } else if (x < 0.) {
+            ++fUnderflow;
+        } else {
+            ++fOverflow;
+        }
+    }
+    
+    void Reset();
+    
+    // [low, high) 分为 nBins 道, 道边界须与细分道对齐.
+    // underflow/overflow 非空时返回视图范围以下/以上的计数
+    std::vector<G4double> GetView(G4double low, G4double high, G4int nBins,
+                                  G4double* underflow = 0, G4double* overflow = 0) const;
+    
+private:
+    G4double fLow;
+    G4double fWidth;
+    G4double fInvWidth;
+    G4int fNBins;
+    std::vector<G4long> fCounts;
+    G4long fUnderflow;
+    G4long fOverflow;
+};
+
+#endif
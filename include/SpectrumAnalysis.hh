@@ -0,0 +1,52 @@
+#ifndef SPECTRUM_ANALYSIS_HH
+#define SPECTRUM_ANALYSIS_HH
+
+#include "globals.hh"
+#include <vector>
+
+// 光电峰拟合结果 (能量单位: keV, 面积单位: 计数)
+struct PeakFitResult
+{
+    G4bool converged;
+    G4double centroid, centroidError;   // 峰位无法拟合时误差取 道宽/√12
+    G4double sigma, sigmaError;
+    G4bool sigmaAtLimit;                // sigma 小于半道宽, 达到可分辨下限 (未展宽峰)
+    G4double roiSigma;                  // ROI所用宽度 max(sigma, 名义宽度)
+    G4double netArea, netAreaError;     // 高斯面积 (净峰面积)
+    G4double roiLow, roiHigh;           // 感兴趣区 centroid ± 3·roiSigma
+    G4double grossCounts;               // ROI内总计数
+    G4double backgroundCounts;          // ROI内拟合本底计数 (线性 + 康普顿台阶)
+    G4double chi2;
+    G4int ndf;
+};
+
+// 基于分箱能谱的峰分析: 峰搜索、高斯+本底 (线性+台阶) 拟合、探测限
+class SpectrumAnalysis
+{
+public:
+    SpectrumAnalysis(const std::vector<G4double>& counts, G4double lowEdge, G4double binWidth);
+    ~SpectrumAnalysis();
+    
+    // 滑动窗口峰搜索, 返回显著性超过阈值的峰位 (keV)
+    std::vector<G4double> SearchPeaks(G4double fwhmGuess, G4double minSignificance) const;
+    
+    // 在 energy ± halfWindow 内拟合 高斯 + 线性本底 + 康普顿台阶 (Levenberg-Marquardt).
+    // ROI宽度不小于 minRoiSigma, 避免未展宽峰的ROI塌缩为单道
+    PeakFitResult FitPeak(G4double energy, G4double halfWindow, G4double minRoiSigma = 0.) const;
+    
+    // Currie 探测限 L_D (计数)
+    static G4double DetectionLimit(G4double backgroundCounts);
+    
+private:
+    G4double BinLow(G4int i) const { return fLowEdge + i * fBinWidth; }
+    G4double BinCenter(G4int i) const { return fLowEdge + (i + 0.5) * fBinWidth; }
+    G4int FindBin(G4double energy) const;
+    G4double Model(const G4double* par, G4double refEnergy, G4int bin) const;
+    G4double Background(const G4double* par, G4double refEnergy, G4int bin) const;
+    
+    std::vector<G4double> fCounts;
+    G4double fLowEdge;
+    G4double fBinWidth;
+};
+
+#endif
@@ -6,6 +6,7 @@
 #include "globals.hh"
 
 class EventAction;
+class G4LogicalVolume;
 
 class SteppingAction : public G4UserSteppingAction
 {
@@ -17,6 +18,7 @@ public:
 
 private:
     EventAction* fEventAction;
+    G4LogicalVolume* fCrystalLog;  // 缓存NaI晶体逻辑体积, 避免每步字符串比较
 };
 
 #endif
@@ -0,0 +1,88 @@
+import argparse
+import numpy as np
+import pandas as pd
+
+# 由源体素响应表 (/nai/responseMap/enable) 计算任意活度分布下的能谱, 无需重新模拟
+#
+# 活度分布文件 (CSV): IX,IY,IZ,Activity_Bq  每个体素内的总活度
+# 期望计数: S(E) = Σ_v A_v * Iγ * t * R(v,E) / N_v
+
+GAMMA_YIELD = 0.851  # 每次衰变发射662 keV光子数
+
+parser = argparse.ArgumentParser(description='Reweight source response map to an activity distribution')
+parser.add_argument('--voxels', default='build/source_response_voxels.csv', help='体素表')
+parser.add_argument('--map', default='build/source_response_map.csv', help='稀疏响应表')
+parser.add_argument('--activity', help='活度分布 CSV (IX,IY,IZ,Activity_Bq)')
+parser.add_argument('--uniform', type=float, help='均匀体活度 (Bq/m3), 代替 --activity')
+parser.add_argument('--time', type=float, default=3600.0, help='测量时间 (s)')
+parser.add_argument('--output', default='reweighted_spectrum.csv', help='输出能谱')
+args = parser.parse_args()
+
+# 读取体素表头部的网格和能量道信息
+header = {}
+with open(args.voxels) as f:
+    for line in f:
+        if not line.startswith('#'):
+            break
+        key, *values = line[1:].split()
+        header[key] = [float(v) for v in values]
+nx, ny, nz = (int(v) for v in header['grid'])
+e_low, e_high, n_channels = header['energy_keV']
+n_channels = int(n_channels)
+
+voxels = pd.read_csv(args.voxels, comment='#')
+response = pd.read_csv(args.map)
+
+# 每个体素的活度 (Bq)
+activity = np.zeros(nx * ny * nz)
+emitted = voxels.sort_values('Voxel')['Emitted'].to_numpy().astype(float)
+if args.uniform is not None:
+    if 'source_volume_m3' in header and emitted.sum() > 0:
+        # 源只在空气中抽样: 体素内空气体积按发射数比例估计 (墙体、家具内为0)
+        voxel_volume = header['source_volume_m3'][0] * emitted / emitted.sum()
+    else:
+        lower = np.array(header['lower_m'])
+        upper = np.array(header['upper_m'])
+        voxel_volume = np.prod((upper - lower) / np.array([nx, ny, nz]))
+    activity[:] = args.uniform * voxel_volume
+elif args.activity is not None:
+    amap = pd.read_csv(args.activity)
+    # 体素号须在网格内, 否则 IX/IY/IZ 越界会被折算到别的体素
+    valid = ((amap['IX'] >= 0) & (amap['IX'] < nx) &
+             (amap['IY'] >= 0) & (amap['IY'] < ny) &
+             (amap['IZ'] >= 0) & (amap['IZ'] < nz))
+    if not valid.all():
+        bad = amap[~valid]
+        print(f"错误: {len(bad)} 行体素号超出网格 {nx}x{ny}x{nz}:")
+        # 行号按文件计, 第1行为表头
+        print(bad.set_axis(bad.index + 2).to_string())
+        raise SystemExit(1)
+    index = (amap['IZ'] * ny + amap['IY']) * nx + amap['IX']
+    np.add.at(activity, index.to_numpy(), amap['Activity_Bq'].to_numpy())
+else:
+    parser.error('需要 --activity 或 --uniform')
+
+missing = (activity > 0) & (emitted == 0)
+if missing.any():
+    print(f"警告: {missing.sum()} 个有活度的体素没有模拟事件, 已忽略")
+
+# 每个模拟光子对应的权重
+weight = np.zeros_like(activity)
+has_events = emitted > 0
+weight[has_events] = activity[has_events] * GAMMA_YIELD * args.time / emitted[has_events]
+
+w = weight[response['Voxel'].to_numpy()]
+counts = np.bincount(response['Channel'], weights=w * response['Counts'], minlength=n_channels)
+errors = np.sqrt(np.bincount(response['Channel'], weights=w**2 * response['Counts'], minlength=n_channels))
+
+bin_width = (e_high - e_low) / n_channels
+pd.DataFrame({
+    'Channel': np.arange(n_channels),
+    'Energy_keV': e_low + np.arange(n_channels) * bin_width,
+    'Counts': counts,
+    'Error': errors,
+}).to_csv(args.output, index=False)
+
+print(f"总活度: {activity.sum():.3g} Bq, 测量时间: {args.time:g} s")
+print(f"能谱总计数: {counts.sum():.3g}")
+print(f"能谱已保存到: {args.output}")
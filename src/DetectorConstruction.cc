@@ -1,11 +1,30 @@
 #include "DetectorConstruction.hh"
+#include "DetectorMessenger.hh"
 #include "G4NistManager.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4SDManager.hh"
 #include "G4MultiFunctionalDetector.hh"
 #include "G4PSEnergyDeposit.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4TessellatedSolid.hh"
+#include "G4Voxelizer.hh"
+#include "G4GeometryManager.hh"
+#include "G4Navigator.hh"
+#include "G4Timer.hh"
+#include "G4ios.hh"
+#include "CLHEP/Random/RanecuEngine.h"
+#ifdef NAI_WITH_GDML
+#include "G4GDMLParser.hh"
+#endif
+#include <cmath>
+#include <set>
 
 DetectorConstruction::DetectorConstruction()
+ : worldPhys(0),
+   naiCrystalLog(0),
+   detectorPosition(0, 0, 0),
+   smartless(0.),            // 0: 保持Geant4默认值
+   tessellatedMaxVoxels(0)   // 0: 保持Geant4默认值
 {
     // 房间尺寸: 40平方米, 高度3米
     roomSizeX = 8.0 * m;  // 8m x 5m = 40m²
@@ -16,10 +35,14 @@ DetectorConstruction::DetectorConstruction()
     naiRadius = 3.81 * cm;  // 3英寸 = 7.62cm直径 → 半径3.81cm
     naiHeight = 7.62 * cm;  // 3英寸高度
     canThickness = 2.0 * mm;  // 铝壳厚度
+    
+    fMessenger = new DetectorMessenger(this);
 }
 
 DetectorConstruction::~DetectorConstruction()
-{}
+{
+    delete fMessenger;
+}
 
 void DetectorConstruction::DefineMaterials()
 {
@@ -44,11 +67,61 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
 {
     DefineMaterials();
     
+    if (gdmlFile.empty()) {
+        worldPhys = ConstructDefaultRoom();
+    } else {
+        worldPhys = ConstructGdmlRoom();
+    }
+    
+    // 探测器放入世界体积
+    PlaceDetector(worldPhys->GetLogicalVolume());
+    
+    // 复杂房间的体素优化
+    TuneVoxelisation();
+    
+    return worldPhys;
+}
+
+G4VPhysicalVolume* DetectorConstruction::ConstructDefaultRoom()
+{
     // 世界体积 - 充满空气的房间
     G4Box* worldSolid = new G4Box("World", roomSizeX/2, roomSizeY/2, roomSizeZ/2);
     G4LogicalVolume* worldLog = new G4LogicalVolume(worldSolid, air, "World");
-    worldPhys = new G4PVPlacement(0, G4ThreeVector(), worldLog, "World", 0, false, 0);
+    return new G4PVPlacement(0, G4ThreeVector(), worldLog, "World", 0, false, 0);
+}
+
+G4VPhysicalVolume* DetectorConstruction::ConstructGdmlRoom()
+{
+#ifdef NAI_WITH_GDML
+    // 从GDML读取世界体积及房间内容 (墙体、家具、屏蔽、CAD网格)
+    // 三角网格在读取时即闭合并建立体素, 体素上限必须在读取前设置
+    G4int defaultVoxels = G4Voxelizer::GetDefaultVoxelsCount();
+    if (tessellatedMaxVoxels > 0) {
+        G4Voxelizer::SetDefaultVoxelsCount(tessellatedMaxVoxels);
+    }
+    
+    G4GDMLParser parser;
+    parser.Read(gdmlFile, false);
+    G4VPhysicalVolume* world = parser.GetWorldVolume();
     
+    G4Voxelizer::SetDefaultVoxelsCount(defaultVoxels);
+    
+    G4cout << "Room geometry loaded from " << gdmlFile << ": "
+           << world->GetLogicalVolume()->GetNoDaughters()
+           << " top-level volumes" << G4endl;
+    return world;
+#else
+    G4ExceptionDescription msg;
+    msg << "Cannot read " << gdmlFile
+        << ": application was built without GDML support (WITH_GDML=OFF).";
+    G4Exception("DetectorConstruction::ConstructGdmlRoom()", "NaI001",
+                FatalException, msg);
+    return 0;
+#endif
+}
+
+void DetectorConstruction::PlaceDetector(G4LogicalVolume* motherLog)
+{
     // NaI探测器铝外壳
     G4Tubs* canSolid = new G4Tubs("NaICan", 
                                   0, 
@@ -57,8 +130,9 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
                                   0, 360*deg);
     G4LogicalVolume* canLog = new G4LogicalVolume(canSolid, aluminum, "NaICan");
     
-    // 将探测器放置在房间中心
-    new G4PVPlacement(0, G4ThreeVector(0, 0, 0), canLog, "NaICan", worldLog, false, 0);
+    // 导入的房间中检查探测器是否与墙体/家具重叠
+    G4bool checkOverlaps = !gdmlFile.empty();
+    new G4PVPlacement(0, detectorPosition, canLog, "NaICan", motherLog, false, 0, checkOverlaps);
     
     // NaI晶体
     G4Tubs* naiSolid = new G4Tubs("NaICrystal", 
@@ -68,8 +142,30 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
                                   0, 360*deg);
     naiCrystalLog = new G4LogicalVolume(naiSolid, nai, "NaICrystal");
     new G4PVPlacement(0, G4ThreeVector(0, 0, 0), naiCrystalLog, "NaICrystal", canLog, false, 0);
+}
+
+void DetectorConstruction::TuneVoxelisation()
+{
+    // 智能体素参数在 CloseGeometry 时生效, 这里只需设置到逻辑体积上
+    std::set<const G4TessellatedSolid*> tessellated;
+    G4LogicalVolumeStore* lvStore = G4LogicalVolumeStore::GetInstance();
+    for (G4LogicalVolume* lv : *lvStore) {
+        if (smartless > 0. && lv->GetNoDaughters() > 0) {
+            lv->SetSmartless(smartless);
+        }
+        const G4TessellatedSolid* tess = dynamic_cast<const G4TessellatedSolid*>(lv->GetSolid());
+        if (tess) tessellated.insert(tess);
+    }
     
-    return worldPhys;
+    if (smartless > 0. || tessellatedMaxVoxels > 0) {
+        G4cout << "Voxelisation:";
+        if (smartless > 0.) G4cout << " smartless = " << smartless << ",";
+        G4cout << " tessellated solids: " << tessellated.size();
+        if (tessellatedMaxVoxels > 0) {
+            G4cout << " (max voxels " << tessellatedMaxVoxels << ")";
+        }
+        G4cout << G4endl;
+    }
 }
 
 void DetectorConstruction::ConstructSDandField()
@@ -85,3 +181,83 @@ void DetectorConstruction::ConstructSDandField()
     // 将灵敏探测器附加到NaI晶体逻辑体积
     SetSensitiveDetector("NaICrystal", naiDetector);
 }
+
+void DetectorConstruction::SetGdmlFile(const G4String& fileName)
+{
+    gdmlFile = fileName;
+}
+
+void DetectorConstruction::SetDetectorPosition(const G4ThreeVector& pos)
+{
+    detectorPosition = pos;
+    G4cout << "NaI detector position set to: " << pos/m << " m" << G4endl;
+}
+
+void DetectorConstruction::SetSmartless(G4double value)
+{
+    smartless = value;
+}
+
+void DetectorConstruction::SetTessellatedMaxVoxels(G4int value)
+{
+    tessellatedMaxVoxels = value;
+}
+
+void DetectorConstruction::BenchmarkNavigation(G4int nRays)
+{
+    if (!worldPhys) return;
+    
+    // 导航前需要建立体素结构
+    G4GeometryManager* geomManager = G4GeometryManager::GetInstance();
+    G4bool wasClosed = geomManager->IsGeometryClosed();
+    if (!wasClosed) geomManager->CloseGeometry(true);
+    
+    G4Navigator navigator;
+    navigator.SetWorldVolume(worldPhys);
+    
+    G4ThreeVector pMin, pMax;
+    worldPhys->GetLogicalVolume()->GetSolid()->BoundingLimits(pMin, pMax);
+    G4ThreeVector extent = pMax - pMin;
+    
+    // 独立随机数引擎, 不影响模拟的随机数序列
+    CLHEP::RanecuEngine engine;
+    const G4int maxStepsPerRay = 100000;
+    G4long nSteps = 0;
+    
+    G4Timer timer;
+    timer.Start();
+    for (G4int i = 0; i < nRays; i++) {
+        G4ThreeVector pos(pMin.x() + extent.x() * engine.flat(),
+                          pMin.y() + extent.y() * engine.flat(),
+                          pMin.z() + extent.z() * engine.flat());
+        G4double phi = 2.0 * M_PI * engine.flat();
+        G4double cosTheta = 2.0 * engine.flat() - 1.0;
+        G4double sinTheta = std::sqrt(1.0 - cosTheta * cosTheta);
+        G4ThreeVector dir(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta);
+        
+        navigator.LocateGlobalPointAndSetup(pos, &dir, false, false);
+        for (G4int n = 0; n < maxStepsPerRay; n++) {
+            G4double safety = 0.;
+            G4double step = navigator.ComputeStep(pos, dir, kInfinity, safety);
+            nSteps++;
+            if (step >= kInfinity) break;
+            
+            pos += step * dir;
+            navigator.SetGeometricallyLimitedStep();
+            if (!navigator.LocateGlobalPointAndSetup(pos, &dir, true)) break;  // 离开世界体积
+        }
+    }
+    timer.Stop();
+    
+    if (!wasClosed) geomManager->OpenGeometry();
+    
+    G4double seconds = timer.GetRealElapsed();
+    G4cout << G4endl
+           << "================ NAVIGATION BENCHMARK ===============" << G4endl
+           << " Rays traced: " << nRays << G4endl
+           << " Navigation steps: " << nSteps << G4endl
+           << " Steps per ray: " << (G4double)nSteps/nRays << G4endl
+           << " Wall time: " << seconds << " s" << G4endl
+           << " Steps/sec: " << (seconds > 0. ? nSteps/seconds : 0.) << G4endl
+           << "=====================================================" << G4endl;
+}
@@ -0,0 +1,78 @@
+#include "DetectorMessenger.hh"
+#include "DetectorConstruction.hh"
+#include "G4SystemOfUnits.hh"
+
+DetectorMessenger::DetectorMessenger(DetectorConstruction* detector)
+ : fDetector(detector)
+{
+    // 创建命令目录
+    fDetDir = new G4UIdirectory("/det/");
+    fDetDir->SetGuidance("Detector and room geometry control commands.");
+    
+    // 房间几何GDML文件
+    fGdmlFileCmd = new G4UIcmdWithAString("/det/gdmlFile", this);
+    fGdmlFileCmd->SetGuidance("Load world and room contents from a GDML file.");
+    fGdmlFileCmd->SetGuidance("Empty string keeps the built-in air box.");
+    fGdmlFileCmd->SetParameterName("fileName", false);
+    fGdmlFileCmd->AvailableForStates(G4State_PreInit);
+    
+    // NaI探测器位置
+    fDetectorPosCmd = new G4UIcmdWith3VectorAndUnit("/det/detectorPosition", this);
+    fDetectorPosCmd->SetGuidance("Set NaI detector position in the world volume.");
+    fDetectorPosCmd->SetParameterName("x", "y", "z", false);
+    fDetectorPosCmd->SetDefaultUnit("m");
+    fDetectorPosCmd->AvailableForStates(G4State_PreInit);
+    
+    // 智能体素参数
+    fSmartlessCmd = new G4UIcmdWithADouble("/det/smartless", this);
+    fSmartlessCmd->SetGuidance("Set smartless (voxels per daughter) for all logical volumes.");
+    fSmartlessCmd->SetGuidance("Geant4 default is 2; larger values help rooms with many daughters.");
+    fSmartlessCmd->SetParameterName("smartless", false);
+    fSmartlessCmd->SetRange("smartless>0.");
+    fSmartlessCmd->AvailableForStates(G4State_PreInit);
+    
+    // 三角网格体素上限
+    fMaxVoxelsCmd = new G4UIcmdWithAnInteger("/det/tessellatedMaxVoxels", this);
+    fMaxVoxelsCmd->SetGuidance("Set maximum number of voxels for tessellated (CAD) solids.");
+    fMaxVoxelsCmd->SetGuidance("Applied while the GDML file is read; 0 keeps the Geant4 default.");
+    fMaxVoxelsCmd->SetParameterName("maxVoxels", false);
+    fMaxVoxelsCmd->SetRange("maxVoxels>=0");
+    fMaxVoxelsCmd->AvailableForStates(G4State_PreInit);
+    
+    // 导航性能测试
+    fBenchmarkCmd = new G4UIcmdWithAnInteger("/det/benchmarkNavigation", this);
+    fBenchmarkCmd->SetGuidance("Trace random rays through the loaded geometry and report steps/sec.");
+    fBenchmarkCmd->SetParameterName("nRays", true);
+    fBenchmarkCmd->SetDefaultValue(10000);
+    fBenchmarkCmd->SetRange("nRays>0");
+    fBenchmarkCmd->AvailableForStates(G4State_Idle);
+}
+
+DetectorMessenger::~DetectorMessenger()
+{
+    delete fGdmlFileCmd;
+    delete fDetectorPosCmd;
+    delete fSmartlessCmd;
+    delete fMaxVoxelsCmd;
+    delete fBenchmarkCmd;
+    delete fDetDir;
+}
+
+void DetectorMessenger::SetNewValue(G4UIcommand* command, G4String newValue)
+{
+    if (command == fGdmlFileCmd) {
+        fDetector->SetGdmlFile(newValue);
+    }
+    else if (command == fDetectorPosCmd) {
+        fDetector->SetDetectorPosition(fDetectorPosCmd->GetNew3VectorValue(newValue));
+    }
+    else if (command == fSmartlessCmd) {
+        fDetector->SetSmartless(fSmartlessCmd->GetNewDoubleValue(newValue));
+    }
+    else if (command == fMaxVoxelsCmd) {
+        fDetector->SetTessellatedMaxVoxels(fMaxVoxelsCmd->GetNewIntValue(newValue));
+    }
+    else if (command == fBenchmarkCmd) {
+        fDetector->BenchmarkNavigation(fBenchmarkCmd->GetNewIntValue(newValue));
+    }
+}
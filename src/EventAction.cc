@@ -5,6 +5,7 @@
 #include "G4UnitsTable.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4AnalysisManager.hh"
+#include "Randomize.hh"
 #include <fstream>
 
 // 添加全局变量来存储击中位置
@@ -14,8 +15,11 @@ namespace {
 
 EventAction::EventAction(RunAction* runAction)
  : fTotalEdep(0.),
-   fRunAction(runAction)
-{}
+   fRunAction(runAction),
+   fNSteps(0)
+{
+    fRngSeeds[0] = fRngSeeds[1] = 0;
+}
 
 EventAction::~EventAction()
 {}
@@ -24,16 +28,36 @@ void EventAction::BeginOfEventAction(const G4Event*)
 {
     fTotalEdep = 0.;
     gHitPosition = G4ThreeVector(0, 0, 0);
+    fNSteps = 0;
+    
+    // 初级粒子已生成, 此后的随机数只用于跟踪; 保存状态以便重放.
+    // Ranecu 的完整状态就是两个种子, 直接复制, 不做序列化
+    if (fRunAction && fRunAction->IsProfilerEnabled() && !fRunAction->IsReplaying()) {
+        const long* seeds = G4Random::getTheSeeds();
+        fRngSeeds[0] = seeds[0];
+        fRngSeeds[1] = seeds[1];
+    }
+    fStartTime = std::chrono::steady_clock::now();
 }
 
 void EventAction::EndOfEventAction(const G4Event* event)
 {
+    G4double wallTime = std::chrono::duration<G4double>(
+        std::chrono::steady_clock::now() - fStartTime).count();
+    
+    // 重放事件: 只输出结果, 不计入能谱和统计
+    if (fRunAction && fRunAction->IsReplaying()) {
+        G4cout << "Replayed event - Energy deposit: " << fTotalEdep/keV << " keV"
+               << ", steps: " << fNSteps
+               << ", wall time: " << wallTime * 1e3 << " ms" << G4endl;
+        return;
+    }
+    
     auto analysisManager = G4AnalysisManager::Instance();
     
     if (fTotalEdep > 0.) {
-        // 填充能谱直方图
-        analysisManager->FillH1(0, fTotalEdep);  // 全范围能谱
-        analysisManager->FillH1(1, fTotalEdep);  // 放大区域能谱
+        // 填充能谱计数 (全谱和放大谱共用一次道号计算)
+        if (fRunAction) fRunAction->FillSpectrum(fTotalEdep);
         
         // 填充详细信息的Ntuple
         analysisManager->FillNtupleDColumn(0, fTotalEdep);      // 能量
@@ -53,6 +77,32 @@ void EventAction::EndOfEventAction(const G4Event* event)
     if (fRunAction && fTotalEdep > 0.) {
         fRunAction->AddEnergyDeposit(fTotalEdep);
     }
+    
+    // 源体素响应 (包括无沉积事件, 用于归一化)
+    if (fRunAction && fRunAction->IsResponseMapEnabled() && event->GetPrimaryVertex()) {
+        fRunAction->RecordSourceResponse(event->GetPrimaryVertex()->GetPosition(), fTotalEdep);
+    }
+    
+    // 慢事件统计: 只有进入最慢表的事件才组装记录
+    if (fRunAction && fRunAction->IsProfilerEnabled()) {
+        SlowEventProfiler& profiler = fRunAction->GetProfiler();
+        if (profiler.AddEvent(wallTime)) {
+            SlowEventRecord record;
+            record.eventID = event->GetEventID();
+            record.wallTime = wallTime;
+            record.steps = fNSteps;
+            record.rngSeeds[0] = fRngSeeds[0];
+            record.rngSeeds[1] = fRngSeeds[1];
+            record.energy = 0.;
+            const G4PrimaryVertex* vertex = event->GetPrimaryVertex();
+            if (vertex && vertex->GetPrimary()) {
+                record.vertex = vertex->GetPosition();
+                record.direction = vertex->GetPrimary()->GetMomentumDirection();
+                record.energy = vertex->GetPrimary()->GetKineticEnergy();
+            }
+            profiler.Insert(record);
+        }
+    }
 }
 
 // 添加设置击中位置的方法
@@ -1,28 +1,119 @@
 #include "PrimaryGeneratorAction.hh"
 #include "PrimaryGeneratorMessenger.hh"
-#include "G4ParticleTable.hh"
 #include "G4ParticleDefinition.hh"
+#include "G4Gamma.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4PrimaryParticle.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4Timer.hh"
+#include "G4Navigator.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4LogicalVolume.hh"
+#include "G4VSolid.hh"
+#include "G4TransportationManager.hh"
 #include "Randomize.hh"
+#include <cmath>
+#include <sstream>
+
+namespace {
+    // 由均匀随机数 u 计算 phi = 2π(u - 0.5) 的 sin/cos.
+    // 半角 |x| <= π/2 上的多项式, 无分支, 可被编译器向量化; 误差约 1e-9
+    void SinCosBlock(const G4double* u, G4double* sinPhi, G4double* cosPhi, G4int n)
+    {
+        #pragma omp simd
+        for (G4int i = 0; i < n; i++) {
+            G4double x = M_PI * (u[i] - 0.5);
+            G4double x2 = x * x;
+            G4double s = x * (1. + x2 * (-1./6. + x2 * (1./120. + x2 * (-1./5040. + x2 * (1./362880.
+                       + x2 * (-1./39916800. + x2 * (1./6227020800.)))))));
+            G4double c = 1. + x2 * (-1./2. + x2 * (1./24. + x2 * (-1./720. + x2 * (1./40320.
+                       + x2 * (-1./3628800. + x2 * (1./479001600. + x2 * (-1./87178291200.)))))));
+            sinPhi[i] = 2. * s * c;
+            cosPhi[i] = c * c - s * s;
+        }
+    }
+}
 
 PrimaryGeneratorAction::PrimaryGeneratorAction()
- : cs137Activity(1.0),
+ : fGamma(G4Gamma::Definition()),
+   cs137Activity(1.0),
    roomVolume(120.0),
-   testMode(false)  // 默认关闭测试模式
+   testMode(false),  // 默认关闭测试模式
+   fSourceWorld(0),
+   fSourceLower(-4.0 * m, -2.5 * m, -1.5 * m),  // 世界体积建立前: 默认 8m x 5m x 3m 房间
+   fSourceUpper(4.0 * m, 2.5 * m, 1.5 * m),
+   fDetectorPosition(0, 0, 0),
+   fBatchSize(1024),
+   fBlockIndex(0),
+   fReplayPending(false),
+   fReplayEnergy(0.)
 {
     particleGun = new G4ParticleGun(1);
     fMessenger = new PrimaryGeneratorMessenger(this);
+    fSourceNavigator = new G4Navigator();
+    fReplayRngSeeds[0] = fReplayRngSeeds[1] = 0;
 }
 
 PrimaryGeneratorAction::~PrimaryGeneratorAction()
 {
+    delete fSourceNavigator;
     delete fMessenger;
     delete particleGun;
 }
 
+void PrimaryGeneratorAction::UpdateSourceRegion()
+{
+    G4VPhysicalVolume* world = G4TransportationManager::GetTransportationManager()
+                                   ->GetNavigatorForTracking()->GetWorldVolume();
+    if (!world || world == fSourceWorld) return;
+    
+    fSourceWorld = world;
+    fSourceNavigator->SetWorldVolume(world);
+    G4LogicalVolume* worldLog = world->GetLogicalVolume();
+    worldLog->GetSolid()->BoundingLimits(fSourceLower, fSourceUpper);
+    
+    // 源所在空气体积 = 世界体积 - 各子体积 (墙体、家具、屏蔽、探测器)
+    G4double volume = worldLog->GetSolid()->GetCubicVolume();
+    // 同时取已放置探测器外壳的实际位置, 供测试模式使用
+    for (G4int i = 0; i < (G4int)worldLog->GetNoDaughters(); i++) {
+        G4VPhysicalVolume* daughter = worldLog->GetDaughter(i);
+        volume -= daughter->GetLogicalVolume()->GetSolid()->GetCubicVolume();
+        if (daughter->GetName() == "NaICan") fDetectorPosition = daughter->GetTranslation();
+    }
+    if (volume <= 0.) {
+        G4Exception("PrimaryGeneratorAction::UpdateSourceRegion()", "NaI003",
+                    FatalException, "World volume leaves no space for the source.");
+    }
+    roomVolume = volume / m3;
+    
+    // 旧区域中生成的顶点作废
+    fBlockX.clear();
+    fBlockIndex = 0;
+    
+    G4cout << "Source region: " << fSourceLower/m << " - " << fSourceUpper/m
+           << " m, air volume " << roomVolume << " m3" << G4endl;
+}
+
+void PrimaryGeneratorAction::GetSourceRegion(G4ThreeVector& lower, G4ThreeVector& upper) const
+{
+    lower = fSourceLower;
+    upper = fSourceUpper;
+}
+
+// 点位于世界体积本身 (空气) 中, 而不在任何子体积内
+G4bool PrimaryGeneratorAction::IsSourcePoint(const G4ThreeVector& pos)
+{
+    if (!fSourceWorld) return true;
+    return fSourceNavigator->LocateGlobalPointAndSetup(pos, 0, false, true) == fSourceWorld;
+}
+
 void PrimaryGeneratorAction::GeneratePrimaries(G4Event* event)
 {
-    if (testMode) {
+    UpdateSourceRegion();
+    
+    if (fReplayPending) {
+        GenerateReplayGamma(event);  // 重放慢事件
+    } else if (testMode) {
         GenerateTestGamma(event);  // 测试模式：固定位置
     } else {
         GenerateCs137Decay(event); // 正常模式：随机位置
@@ -31,17 +122,23 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event* event)
 
 void PrimaryGeneratorAction::GenerateCs137Decay(G4Event* event)
 {
-    GenerateGamma662(event);
+    if (fBatchSize > 0) {
+        GenerateGamma662Batched(event);
+    } else {
+        GenerateGamma662(event);
+    }
 }
 
 void PrimaryGeneratorAction::GenerateGamma662(G4Event* event)
 {
-    G4ParticleDefinition* gamma = G4ParticleTable::GetParticleTable()->FindParticle("gamma");
-    
-    // 正常模式：在房间内随机位置
-    G4double x = (G4UniformRand() - 0.5) * 8.0 * m;
-    G4double y = (G4UniformRand() - 0.5) * 5.0 * m; 
-    G4double z = (G4UniformRand() - 0.5) * 3.0 * m;
+    // 正常模式：在房间空气中随机位置 (舍弃落在墙体、家具、探测器中的点)
+    G4ThreeVector extent = fSourceUpper - fSourceLower;
+    G4ThreeVector position;
+    do {
+        position.set(fSourceLower.x() + G4UniformRand() * extent.x(),
+                     fSourceLower.y() + G4UniformRand() * extent.y(),
+                     fSourceLower.z() + G4UniformRand() * extent.z());
+    } while (!IsSourcePoint(position));
     
     // 随机方向
     G4double phi = 2.0 * M_PI * G4UniformRand();
@@ -52,29 +149,124 @@ void PrimaryGeneratorAction::GenerateGamma662(G4Event* event)
                            sinTheta * std::sin(phi), 
                            cosTheta);
     
-    particleGun->SetParticleDefinition(gamma);
+    particleGun->SetParticleDefinition(fGamma);
     particleGun->SetParticleEnergy(662 * keV);
-    particleGun->SetParticlePosition(G4ThreeVector(x, y, z));
+    particleGun->SetParticlePosition(position);
     particleGun->SetParticleMomentumDirection(direction);
     particleGun->GeneratePrimaryVertex(event);
 }
 
+// 批量模式：从预生成的顶点块中取出, 直接构造 G4PrimaryVertex
+void PrimaryGeneratorAction::GenerateGamma662Batched(G4Event* event)
+{
+    // 每次运行从新块开始: 上次运行剩余的顶点来自旧的随机数状态,
+    // 会使 /random/setSeeds 后的运行无法复现
+    if (event->GetEventID() == 0 || fBlockIndex >= fBlockX.size()) FillBlock();
+    size_t i = fBlockIndex++;
+    
+    G4PrimaryParticle* particle = new G4PrimaryParticle(fGamma);
+    particle->SetKineticEnergy(662 * keV);
+    particle->SetMomentumDirection(G4ThreeVector(fBlockU[i], fBlockV[i], fBlockW[i]));
+    
+    G4PrimaryVertex* vertex = new G4PrimaryVertex(fBlockX[i], fBlockY[i], fBlockZ[i], 0.);
+    vertex->SetPrimary(particle);
+    event->AddPrimaryVertex(vertex);
+}
+
+void PrimaryGeneratorAction::FillBlock()
+{
+    size_t n = fBatchSize;
+    fRandoms.resize(6 * n);
+    G4ThreeVector extent = fSourceUpper - fSourceLower;
+    
+    do {
+        fBlockX.resize(n);
+        fBlockY.resize(n);
+        fBlockZ.resize(n);
+        fBlockU.resize(n);
+        fBlockV.resize(n);
+        fBlockW.resize(n);
+        
+        // 一次取出整块随机数: 位置 x,y,z | phi | cosTheta.
+        // RanecuEngine::flatArray 内部仍逐个调用 flat(), 随机数本身不是向量化生成的;
+        // 块生成节省的是逐事件的虚调用和G4ParticleGun开销, 向量化的只有下面的sincos
+        G4Random::getTheEngine()->flatArray((G4int)(6 * n), fRandoms.data());
+        const G4double* rx = fRandoms.data();
+        const G4double* ry = rx + n;
+        const G4double* rz = ry + n;
+        const G4double* rPhi = rz + n;
+        const G4double* rCos = rPhi + n;
+        
+        for (size_t i = 0; i < n; i++) {
+            fBlockX[i] = fSourceLower.x() + rx[i] * extent.x();
+            fBlockY[i] = fSourceLower.y() + ry[i] * extent.y();
+            fBlockZ[i] = fSourceLower.z() + rz[i] * extent.z();
+        }
+        
+        // 随机方向: 先算 cos/sin(phi), 再乘 sinTheta
+        SinCosBlock(rPhi, fBlockV.data(), fBlockU.data(), (G4int)n);
+        for (size_t i = 0; i < n; i++) {
+            G4double cosTheta = 2.0 * rCos[i] - 1.0;
+            G4double sinTheta = std::sqrt(1.0 - cosTheta * cosTheta);
+            fBlockU[i] *= sinTheta;
+            fBlockV[i] *= sinTheta;
+            fBlockW[i] = cosTheta;
+        }
+        
+        // 舍弃落在墙体、家具、探测器中的顶点, 保留的顶点前移
+        size_t accepted = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (!IsSourcePoint(G4ThreeVector(fBlockX[i], fBlockY[i], fBlockZ[i]))) continue;
+            fBlockX[accepted] = fBlockX[i];
+            fBlockY[accepted] = fBlockY[i];
+            fBlockZ[accepted] = fBlockZ[i];
+            fBlockU[accepted] = fBlockU[i];
+            fBlockV[accepted] = fBlockV[i];
+            fBlockW[accepted] = fBlockW[i];
+            accepted++;
+        }
+        fBlockX.resize(accepted);
+        fBlockY.resize(accepted);
+        fBlockZ.resize(accepted);
+        fBlockU.resize(accepted);
+        fBlockV.resize(accepted);
+        fBlockW.resize(accepted);
+    } while (fBlockX.empty());
+    
+    fBlockIndex = 0;
+}
+
+// 重放模式：使用记录的初级粒子, 不消耗随机数
+void PrimaryGeneratorAction::GenerateReplayGamma(G4Event* event)
+{
+    G4PrimaryParticle* particle = new G4PrimaryParticle(fGamma);
+    particle->SetKineticEnergy(fReplayEnergy);
+    particle->SetMomentumDirection(fReplayDirection);
+    
+    G4PrimaryVertex* vertex = new G4PrimaryVertex(fReplayVertex, 0.);
+    vertex->SetPrimary(particle);
+    event->AddPrimaryVertex(vertex);
+    
+    // 恢复原事件跟踪开始时的引擎状态
+    G4Random::setTheSeeds(fReplayRngSeeds);
+    fReplayPending = false;
+}
+
 // 测试模式：固定位置直接射向探测器
 void PrimaryGeneratorAction::GenerateTestGamma(G4Event* event)
 {
-    G4ParticleDefinition* gamma = G4ParticleTable::GetParticleTable()->FindParticle("gamma");
-    
-    // 固定位置：在探测器正前方1米处
-    G4double x = 0.0 * m;
-    G4double y = 0.0 * m;
-    G4double z = 1.0 * m;  // 在探测器正前方
+    // 固定位置：在探测器正前方1米处 (跟随 /det/detectorPosition)
+    G4ThreeVector position = fDetectorPosition + G4ThreeVector(0, 0, 1.0 * m);
+    G4double x = position.x();
+    G4double y = position.y();
+    G4double z = position.z();
     
     // 固定方向：直接射向探测器中心
-    G4ThreeVector direction(0, 0, -1);  // 指向原点（探测器位置）
+    G4ThreeVector direction(0, 0, -1);  // 指向探测器位置
     
-    particleGun->SetParticleDefinition(gamma);
+    particleGun->SetParticleDefinition(fGamma);
     particleGun->SetParticleEnergy(662 * keV);
-    particleGun->SetParticlePosition(G4ThreeVector(x, y, z));
+    particleGun->SetParticlePosition(position);
     particleGun->SetParticleMomentumDirection(direction);
     particleGun->GeneratePrimaryVertex(event);
     
@@ -98,13 +290,80 @@ void PrimaryGeneratorAction::SetTestMode(G4bool mode)
     testMode = mode;
     if (testMode) {
         G4cout << "=== TEST MODE ACTIVATED ===" << G4endl;
-        G4cout << "Gamma source fixed at (0, 0, 1) m" << G4endl;
+        G4cout << "Gamma source fixed 1 m above the detector (+z)" << G4endl;
         G4cout << "Directly shooting toward detector" << G4endl;
     } else {
         G4cout << "=== NORMAL MODE ===" << G4endl;
     }
 }
 
+void PrimaryGeneratorAction::SetBatchSize(G4int size)
+{
+    fBatchSize = size;
+    // 丢弃旧块, 下一个事件按新的块大小重新生成
+    fBlockX.clear();
+    fBlockIndex = 0;
+    G4cout << "Primary batch size set to: " << fBatchSize
+           << (fBatchSize > 0 ? "" : " (G4ParticleGun per event)") << G4endl;
+}
+
+void PrimaryGeneratorAction::BenchmarkPrimaries(G4int nPrimaries)
+{
+    // 与实际事件相同的抽样区域和舍选 (首次 beamOn 之前也适用)
+    UpdateSourceRegion();
+    
+    // 保存随机数状态, 测试结束后恢复, 不影响后续模拟
+    std::stringstream engineState;
+    G4Random::saveFullState(engineState);
+    G4int savedBatchSize = fBatchSize;
+    
+    G4Timer timer;
+    timer.Start();
+    for (G4int i = 0; i < nPrimaries; i++) {
+        G4Event event(i);
+        GenerateGamma662(&event);
+    }
+    timer.Stop();
+    G4double scalarTime = timer.GetRealElapsed();
+    
+    if (fBatchSize <= 0) fBatchSize = 1024;
+    fBlockX.clear();
+    fBlockIndex = 0;
+    timer.Start();
+    for (G4int i = 0; i < nPrimaries; i++) {
+        G4Event event(i);
+        GenerateGamma662Batched(&event);
+    }
+    timer.Stop();
+    G4double batchedTime = timer.GetRealElapsed();
+    
+    fBatchSize = savedBatchSize;
+    fBlockX.clear();
+    fBlockIndex = 0;
+    G4Random::restoreFullState(engineState);
+    
+    G4cout << G4endl
+           << "================= PRIMARY BENCHMARK =================" << G4endl
+           << " Primaries per path: " << nPrimaries << G4endl
+           << " G4ParticleGun:  " << (scalarTime > 0. ? nPrimaries / scalarTime : 0.)
+           << " primaries/sec" << G4endl
+           << " Batched (" << (savedBatchSize > 0 ? savedBatchSize : 1024) << "): "
+           << (batchedTime > 0. ? nPrimaries / batchedTime : 0.) << " primaries/sec" << G4endl
+           << "=====================================================" << G4endl;
+}
+
+void PrimaryGeneratorAction::SetReplayEvent(const G4ThreeVector& vertex,
+                                            const G4ThreeVector& direction,
+                                            G4double energy, const long* rngSeeds)
+{
+    fReplayPending = true;
+    fReplayVertex = vertex;
+    fReplayDirection = direction;
+    fReplayEnergy = energy;
+    fReplayRngSeeds[0] = rngSeeds[0];
+    fReplayRngSeeds[1] = rngSeeds[1];
+}
+
 G4double PrimaryGeneratorAction::GetCs137Activity() const 
 { 
     return cs137Activity; 
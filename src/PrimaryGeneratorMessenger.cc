@@ -22,12 +22,33 @@ PrimaryGeneratorMessenger::PrimaryGeneratorMessenger(PrimaryGeneratorAction* act
     fTestModeCmd->SetParameterName("testMode", true);
     fTestModeCmd->SetDefaultValue(false);
     fTestModeCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    
+    // 批量生成块大小
+    fBatchSizeCmd = new G4UIcmdWithAnInteger("/gun/batchSize", this);
+    fBatchSizeCmd->SetGuidance("Number of primaries pre-generated per block in normal mode.");
+    fBatchSizeCmd->SetGuidance("0 uses G4ParticleGun for every event.");
+    fBatchSizeCmd->SetGuidance("Random numbers still come one by one from the Ranecu engine;");
+    fBatchSizeCmd->SetGuidance("only the direction sincos is vectorised.");
+    fBatchSizeCmd->SetParameterName("batchSize", true);
+    fBatchSizeCmd->SetDefaultValue(1024);
+    fBatchSizeCmd->SetRange("batchSize>=0");
+    fBatchSizeCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    
+    // 生成速度测试
+    fBenchmarkCmd = new G4UIcmdWithAnInteger("/gun/benchmark", this);
+    fBenchmarkCmd->SetGuidance("Report primaries/sec for G4ParticleGun and batched generation.");
+    fBenchmarkCmd->SetParameterName("nPrimaries", true);
+    fBenchmarkCmd->SetDefaultValue(1000000);
+    fBenchmarkCmd->SetRange("nPrimaries>0");
+    fBenchmarkCmd->AvailableForStates(G4State_Idle);
 }
 
 PrimaryGeneratorMessenger::~PrimaryGeneratorMessenger()
 {
     delete fCs137ActivityCmd;
     delete fTestModeCmd;
+    delete fBatchSizeCmd;
+    delete fBenchmarkCmd;
     delete fGunDir;
 }
 
@@ -41,4 +62,10 @@ void PrimaryGeneratorMessenger::SetNewValue(G4UIcommand* command, G4String newVa
         G4bool testMode = fTestModeCmd->GetNewBoolValue(newValue);
         fAction->SetTestMode(testMode);
     }
+    else if (command == fBatchSizeCmd) {
+        fAction->SetBatchSize(fBatchSizeCmd->GetNewIntValue(newValue));
+    }
+    else if (command == fBenchmarkCmd) {
+        fAction->BenchmarkPrimaries(fBenchmarkCmd->GetNewIntValue(newValue));
+    }
 }
@@ -1,15 +1,72 @@
 #include "RunAction.hh"
+#include "RunMessenger.hh"
+#include "PrimaryGeneratorAction.hh"
+#include "SpectrumAnalysis.hh"
 #include "G4Run.hh"
 #include "G4RunManager.hh"
 #include "G4UnitsTable.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4AnalysisManager.hh"
+#include "G4UImanager.hh"
+#include "G4EventManager.hh"
+#include "G4TrackingManager.hh"
+#include "Randomize.hh"
+#include <algorithm>
+#include <cmath>
 #include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace {
+    const G4double kCs137GammaEnergy = 661.657;  // keV
+    const G4double kCs137GammaYield = 0.851;     // 每次衰变发射662 keV光子数
+    
+    // 能谱视图: 均由 1 keV 细分道合并
+    const G4double kFullLow = 0.;
+    const G4double kFullHigh = 2000. * keV;
+    const G4int kFullBins = 1000;    // 2 keV/道
+    const G4double kZoomLow = 600. * keV;
+    const G4double kZoomHigh = 800. * keV;
+    const G4int kZoomBins = 200;     // 1 keV/道
+    const G4int kFineBins = 2000;    // 1 keV/道
+    
+    // 将合并后的计数直接写入直方图各道 (含下溢/上溢道).
+    // 每道计数为未加权事件数, 故 entries = Sw = Sw2 = n, 误差为 sqrt(n)
+    void FillHistogram(G4int id, const SpectrumAccumulator& spectrum,
+                       G4double low, G4double high, G4int nBins)
+    {
+        G4double underflow = 0., overflow = 0.;
+        std::vector<G4double> counts = spectrum.GetView(low, high, nBins, &underflow, &overflow);
+        
+        G4H1* h1 = G4AnalysisManager::Instance()->GetH1(id);
+        if (!h1) return;
+        h1->reset();
+        
+        G4double width = (high - low) / nBins;
+        h1->set_bin_content(0, (size_t)underflow, underflow, underflow, 0., 0.);
+        for (G4int i = 0; i < nBins; i++) {
+            G4double n = counts[i];
+            G4double x = low + (i + 0.5) * width;
+            h1->set_bin_content(i + 1, (size_t)n, n, n, x * n, x * x * n);
+        }
+        h1->set_bin_content(nBins + 1, (size_t)overflow, overflow, overflow, 0., 0.);
+    }
+}
 
 RunAction::RunAction()
  : totalEnergyDeposit(0.),
-   numEvents(0)
+   numEvents(0),
+   fSpectrum(kFullLow, kFullHigh, kFineBins),
+   fResponseMapEnabled(false),
+   fProfilerEnabled(false),
+   fReplaying(false),
+   fNominalFWHM(45. * keV)  // 3" NaI 在662 keV约7%
 {
+    fMessenger = new RunMessenger(this);
+    
+    // 响应表能量道与 gamma_spectrum_data.csv 一致
+    fResponseMap.SetEnergyBinning(kFullLow, kFullHigh, kFullBins);
+    
     // 创建分析管理器
     G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
     
@@ -17,11 +74,12 @@ RunAction::RunAction()
     analysisManager->SetDefaultFileType("csv");
     
     // 创建能谱直方图 - 重点在这里
+    // 事件循环中只填充 fSpectrum, 运行结束时按道写入直方图
     analysisManager->CreateH1("EnergySpectrum", "Gamma Energy Spectrum in NaI", 
-                             1000, 0., 2000.*keV);  // 0-2000 keV, 1000通道
+                             kFullBins, kFullLow, kFullHigh);  // 0-2000 keV, 1000通道
     
     analysisManager->CreateH1("EnergySpectrum_zoom", "Gamma Energy Spectrum (662 keV region)", 
-                             200, 600.*keV, 800.*keV);  // 662 keV附近区域
+                             kZoomBins, kZoomLow, kZoomHigh);  // 662 keV附近区域
     
     // 创建Ntuple存储详细信息
     analysisManager->CreateNtuple("GammaSpectrum", "Gamma Spectrum Data");
@@ -35,16 +93,41 @@ RunAction::RunAction()
 
 RunAction::~RunAction()
 {
-    // 析构函数实现
+    delete fMessenger;
 }
 
 void RunAction::BeginOfRunAction(const G4Run* run)
 {
+    if (fReplaying) {
+        G4cout << "### Replay run " << run->GetRunID() << " start." << G4endl;
+        return;
+    }
+    
     G4cout << "### Run " << run->GetRunID() << " start." << G4endl;
     
     // 重置计数器
     totalEnergyDeposit = 0.;
     numEvents = 0;
+    fSpectrum.Reset();
+    fProfiler.Reset();
+    
+    // 源抽样区域与空气体积取自当前世界体积 (MDA和体素网格都依赖它).
+    // 运行管理器只提供 const 指针; 生成器归本程序所有, 第一个事件之前需在此刷新区域
+    PrimaryGeneratorAction* generator = const_cast<PrimaryGeneratorAction*>(
+        static_cast<const PrimaryGeneratorAction*>(
+            G4RunManager::GetRunManager()->GetUserPrimaryGeneratorAction()));
+    if (generator) generator->UpdateSourceRegion();
+    
+    // 体素网格覆盖源抽样区域 (房间)
+    if (fResponseMapEnabled) {
+        if (generator) {
+            G4ThreeVector lower, upper;
+            generator->GetSourceRegion(lower, upper);
+            fResponseMap.SetExtent(lower, upper);
+            fResponseMap.SetSourceVolume(generator->GetRoomVolume() * m3);
+        }
+        fResponseMap.Reset();
+    }
     
     // 打开输出文件
     G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
@@ -53,6 +136,8 @@ void RunAction::BeginOfRunAction(const G4Run* run)
 
 void RunAction::EndOfRunAction(const G4Run* run)
 {
+    if (fReplaying) return;
+    
     G4int nofEvents = run->GetNumberOfEvent();
     if (nofEvents == 0) return;
     
@@ -74,32 +159,150 @@ void RunAction::EndOfRunAction(const G4Run* run)
            << " Detection efficiency: " << (G4double)numEvents/nofEvents * 100.0 << " %" << G4endl
            << "=====================================================" << G4endl;
     
+    // 能谱分析和能谱数据文件直接读取 fSpectrum
+    AnalyseSpectrum(nofEvents);
+    GenerateSpectrumData();
+    
     // 保存分析数据
     G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
+    FillHistogram(analysisManager->GetH1Id("EnergySpectrum"), fSpectrum, kFullLow, kFullHigh, kFullBins);
+    FillHistogram(analysisManager->GetH1Id("EnergySpectrum_zoom"), fSpectrum, kZoomLow, kZoomHigh, kZoomBins);
     analysisManager->Write();
     analysisManager->CloseFile();
     
-    // 生成专门的能谱数据文件
-    GenerateSpectrumData();
+    if (fResponseMapEnabled) {
+        fResponseMap.Write("source_response_voxels.csv", "source_response_map.csv");
+    }
+    
+    if (fProfilerEnabled) {
+        fProfiler.Print();
+        fProfiler.Write("slow_events.csv");
+    }
+}
+
+void RunAction::AnalyseSpectrum(G4int nofEvents)
+{
+    // 全谱用于峰搜索, 放大谱 (1 keV/道) 用于拟合662 keV峰
+    SpectrumAnalysis fullAnalysis(fSpectrum.GetView(kFullLow, kFullHigh, kFullBins),
+                                  kFullLow / keV, (kFullHigh - kFullLow) / kFullBins / keV);
+    std::vector<G4double> peaks = fullAnalysis.SearchPeaks(fNominalFWHM / keV, 5.0);
+    
+    SpectrumAnalysis zoomAnalysis(fSpectrum.GetView(kZoomLow, kZoomHigh, kZoomBins),
+                                  kZoomLow / keV, (kZoomHigh - kZoomLow) / kZoomBins / keV);
+    // ROI宽度不小于名义分辨率; 拟合窗口覆盖整个ROI并留出本底
+    G4double nominalSigma = fNominalFWHM / keV / 2.355;
+    PeakFitResult fit = zoomAnalysis.FitPeak(kCs137GammaEnergy, std::max(40.0, 4. * nominalSigma),
+                                             nominalSigma);
+    
+    // 自洽检查: ROI内本底应与 总计数 - 净面积 在误差内一致
+    G4double backgroundResidual = fit.grossCounts - fit.netArea - fit.backgroundCounts;
+    G4double backgroundTolerance = 3. * std::sqrt(std::max(fit.grossCounts, 1.)
+                                                  + fit.netAreaError * fit.netAreaError);
+    G4bool backgroundConsistent = std::fabs(backgroundResidual) <= backgroundTolerance;
+    if (fit.converged && !backgroundConsistent) {
+        G4ExceptionDescription msg;
+        msg << "ROI background " << fit.backgroundCounts << " differs from gross - net = "
+            << fit.grossCounts - fit.netArea << " by more than " << backgroundTolerance
+            << " counts; the MDA is unreliable.";
+        G4Exception("RunAction::AnalyseSpectrum()", "NaI005", JustWarning, msg);
+    }
+    
+    // 全能峰效率: 每个发射的662 keV光子对应的净峰计数
+    G4double efficiency = fit.netArea / nofEvents;
+    G4double efficiencyError = fit.netAreaError / nofEvents;
+    
+    // 模拟光子数对应的等效测量时间, 以及该时间下的Currie MDA
+    const PrimaryGeneratorAction* generator = static_cast<const PrimaryGeneratorAction*>(
+        G4RunManager::GetRunManager()->GetUserPrimaryGeneratorAction());
+    G4double activity = generator ? generator->GetCs137Activity() : 0.;  // Bq/m3
+    G4double volume = generator ? generator->GetRoomVolume() : 0.;      // m3
+    G4double gammaRate = activity * volume * kCs137GammaYield;           // 光子/s
+    G4double liveTime = gammaRate > 0. ? nofEvents / gammaRate : 0.;     // s
+    G4double detectionLimit = SpectrumAnalysis::DetectionLimit(fit.backgroundCounts);
+    G4double mda = 0.;  // Bq/m3
+    if (efficiency > 0. && liveTime > 0.) {
+        mda = detectionLimit / (efficiency * kCs137GammaYield * liveTime * volume);
+    }
+    
+    G4cout << G4endl
+           << "================= PHOTOPEAK ANALYSIS ================" << G4endl
+           << " Peaks found (keV):";
+    for (size_t i = 0; i < peaks.size(); i++) G4cout << " " << peaks[i];
+    G4cout << G4endl
+           << " 662 keV fit " << (fit.converged ? "converged" : "FAILED")
+           << ": centroid " << fit.centroid << " +- " << fit.centroidError << " keV"
+           << ", FWHM " << 2.355 * fit.sigma << " keV"
+           << ", chi2/ndf " << fit.chi2 << "/" << fit.ndf << G4endl
+           << " ROI " << fit.roiLow << " - " << fit.roiHigh << " keV"
+           << (fit.sigmaAtLimit ? " (sigma at lower limit, nominal FWHM used)" : "") << G4endl
+           << " Net peak area: " << fit.netArea << " +- " << fit.netAreaError << G4endl
+           << " Full-energy-peak efficiency: " << efficiency << " +- " << efficiencyError << G4endl
+           << " Equivalent live time: " << liveTime << " s" << G4endl
+           << " MDA: " << mda << " Bq/m3 (" << mda * volume << " Bq)" << G4endl
+           << "=====================================================" << G4endl;
+    
+    // JSON摘要, 常规质检无需事件级数据
+    std::ofstream jsonFile("spectrum_analysis.json");
+    if (jsonFile.is_open()) {
+        jsonFile << "{" << std::endl;
+        jsonFile << "  \"primaries\": " << nofEvents << "," << std::endl;
+        jsonFile << "  \"events_with_deposit\": " << numEvents << "," << std::endl;
+        jsonFile << "  \"peaks_keV\": [";
+        for (size_t i = 0; i < peaks.size(); i++) {
+            jsonFile << (i ? ", " : "") << peaks[i];
+        }
+        jsonFile << "]," << std::endl;
+        jsonFile << "  \"photopeak\": {" << std::endl;
+        jsonFile << "    \"energy_keV\": " << kCs137GammaEnergy << "," << std::endl;
+        jsonFile << "    \"converged\": " << (fit.converged ? "true" : "false") << "," << std::endl;
+        jsonFile << "    \"centroid_keV\": " << fit.centroid << "," << std::endl;
+        jsonFile << "    \"centroid_error_keV\": " << fit.centroidError << "," << std::endl;
+        jsonFile << "    \"sigma_keV\": " << fit.sigma << "," << std::endl;
+        // 未展宽峰的宽度未拟合, 误差无意义
+        jsonFile << "    \"sigma_error_keV\": ";
+        if (fit.sigmaAtLimit) jsonFile << "null"; else jsonFile << fit.sigmaError;
+        jsonFile << "," << std::endl;
+        jsonFile << "    \"sigma_at_lower_limit\": " << (fit.sigmaAtLimit ? "true" : "false") << "," << std::endl;
+        jsonFile << "    \"fwhm_keV\": " << 2.355 * fit.sigma << "," << std::endl;
+        jsonFile << "    \"net_area\": " << fit.netArea << "," << std::endl;
+        jsonFile << "    \"net_area_error\": " << fit.netAreaError << "," << std::endl;
+        jsonFile << "    \"nominal_fwhm_keV\": " << fNominalFWHM / keV << "," << std::endl;
+        jsonFile << "    \"roi_sigma_keV\": " << fit.roiSigma << "," << std::endl;
+        jsonFile << "    \"roi_keV\": [" << fit.roiLow << ", " << fit.roiHigh << "]," << std::endl;
+        jsonFile << "    \"gross_counts\": " << fit.grossCounts << "," << std::endl;
+        jsonFile << "    \"background_counts\": " << fit.backgroundCounts << "," << std::endl;
+        jsonFile << "    \"background_consistent\": " << (backgroundConsistent ? "true" : "false") << "," << std::endl;
+        jsonFile << "    \"chi2\": " << fit.chi2 << "," << std::endl;
+        jsonFile << "    \"ndf\": " << fit.ndf << std::endl;
+        jsonFile << "  }," << std::endl;
+        jsonFile << "  \"fep_efficiency\": " << efficiency << "," << std::endl;
+        jsonFile << "  \"fep_efficiency_error\": " << efficiencyError << "," << std::endl;
+        jsonFile << "  \"cs137_activity_Bq_m3\": " << activity << "," << std::endl;
+        jsonFile << "  \"room_volume_m3\": " << volume << "," << std::endl;
+        jsonFile << "  \"gamma_yield\": " << kCs137GammaYield << "," << std::endl;
+        jsonFile << "  \"live_time_s\": " << liveTime << "," << std::endl;
+        jsonFile << "  \"detection_limit_counts\": " << detectionLimit << "," << std::endl;
+        jsonFile << "  \"mda_Bq_m3\": " << mda << "," << std::endl;
+        jsonFile << "  \"mda_Bq\": " << mda * volume << std::endl;
+        jsonFile << "}" << std::endl;
+        jsonFile.close();
+        G4cout << "Spectrum analysis summary saved to: spectrum_analysis.json" << G4endl;
+    }
 }
 
 void RunAction::GenerateSpectrumData()
 {
     // 生成便于绘图的能谱数据
-    G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
-    
-    // 获取直方图数据
-    G4int histogramId = analysisManager->GetH1Id("EnergySpectrum");
+    std::vector<G4double> counts = fSpectrum.GetView(kFullLow, kFullHigh, kFullBins);
+    G4double binWidth = (kFullHigh - kFullLow) / kFullBins;
     
     std::ofstream spectrumFile("gamma_spectrum_data.csv");
     if (spectrumFile.is_open()) {
         spectrumFile << "Channel,Energy_keV,Counts" << std::endl;
         
-        // 假设有1000个通道
-        for (G4int i = 0; i < 1000; i++) {
-            G4double energy = i * 2.0; // 每个通道2 keV
-            G4double counts = analysisManager->GetH1(histogramId)->bin_height(i);
-            spectrumFile << i << "," << energy << "," << counts << std::endl;
+        for (G4int i = 0; i < kFullBins; i++) {
+            G4double energy = (kFullLow + i * binWidth) / keV;
+            spectrumFile << i << "," << energy << "," << counts[i] << std::endl;
         }
         spectrumFile.close();
         G4cout << "Gamma spectrum data saved to: gamma_spectrum_data.csv" << G4endl;
@@ -126,6 +329,66 @@ void RunAction::GenerateSpectrumData()
     }
 }
 
+void RunAction::SetResponseMapEnabled(G4bool enable)
+{
+    fResponseMapEnabled = enable;
+    G4cout << "Source response map " << (enable ? "enabled" : "disabled") << G4endl;
+}
+
+void RunAction::SetResponseMapGrid(G4int nx, G4int ny, G4int nz)
+{
+    fResponseMap.SetGrid(nx, ny, nz);
+    G4cout << "Source response map grid set to: "
+           << nx << " x " << ny << " x " << nz << " voxels" << G4endl;
+}
+
+void RunAction::SetProfilerEnabled(G4bool enable)
+{
+    fProfilerEnabled = enable;
+    G4cout << "Slow event profiler " << (enable ? "enabled" : "disabled") << G4endl;
+    
+    // 事件状态只保存两个种子, 仅对 Ranecu 引擎完整
+    if (enable && !dynamic_cast<CLHEP::RanecuEngine*>(G4Random::getTheEngine())) {
+        G4Exception("RunAction::SetProfilerEnabled()", "NaI004", JustWarning,
+                    "Random engine is not RanecuEngine; /run/replayEvent will not reproduce events.");
+    }
+}
+
+void RunAction::ReplayEvent(G4int eventID)
+{
+    const SlowEventRecord* record = fProfiler.Find(eventID);
+    if (!record) {
+        G4cout << "Event " << eventID << " is not in the slow event table "
+               << "(enable /nai/profiler/enable before the run)." << G4endl;
+        return;
+    }
+    
+    // 运行管理器只提供 const 指针; 重放需向生成器写入待重放的初级粒子
+    PrimaryGeneratorAction* generator = const_cast<PrimaryGeneratorAction*>(
+        static_cast<const PrimaryGeneratorAction*>(
+            G4RunManager::GetRunManager()->GetUserPrimaryGeneratorAction()));
+    if (!generator) return;
+    
+    G4cout << G4endl << "=== Replaying event " << eventID << " ("
+           << record->wallTime * 1e3 << " ms, " << record->steps << " steps) ===" << G4endl;
+    
+    // 重放结束后恢复当前随机数序列, 不影响后续运行
+    std::stringstream engineState;
+    G4Random::saveFullState(engineState);
+    
+    generator->SetReplayEvent(record->vertex, record->direction, record->energy, record->rngSeeds);
+    
+    G4UImanager* UImanager = G4UImanager::GetUIpointer();
+    G4int trackingVerbose = G4EventManager::GetEventManager()->GetTrackingManager()->GetVerboseLevel();
+    fReplaying = true;
+    UImanager->ApplyCommand("/tracking/verbose 1");
+    UImanager->ApplyCommand("/run/beamOn 1");
+    UImanager->ApplyCommand("/tracking/verbose " + std::to_string(trackingVerbose));
+    fReplaying = false;
+    
+    G4Random::restoreFullState(engineState);
+}
+
 void RunAction::AddEnergyDeposit(G4double edep)
 {
     totalEnergyDeposit += edep;
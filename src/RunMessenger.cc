@@ -0,0 +1,115 @@
+#include "RunMessenger.hh"
+#include "RunAction.hh"
+#include "G4UIparameter.hh"
+#include <sstream>
+
+RunMessenger::RunMessenger(RunAction* action)
+ : fAction(action)
+{
+    // 创建命令目录
+    fNaIDir = new G4UIdirectory("/nai/");
+    fNaIDir->SetGuidance("NaI simulation run and output control commands.");
+    
+    fResponseMapDir = new G4UIdirectory("/nai/responseMap/");
+    fResponseMapDir->SetGuidance("Source-voxel x energy-channel response tally.");
+    
+    // 源体素响应记录开关
+    fResponseMapCmd = new G4UIcmdWithABool("/nai/responseMap/enable", this);
+    fResponseMapCmd->SetGuidance("Record source voxel and detector response of every event.");
+    fResponseMapCmd->SetGuidance("Use reweight_spectrum.py to build spectra for any activity map.");
+    fResponseMapCmd->SetParameterName("enable", true);
+    fResponseMapCmd->SetDefaultValue(true);
+    fResponseMapCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    
+    // 体素网格
+    fResponseGridCmd = new G4UIcommand("/nai/responseMap/grid", this);
+    fResponseGridCmd->SetGuidance("Set number of source voxels along x, y and z of the room.");
+    G4UIparameter* nx = new G4UIparameter("nx", 'i', false);
+    nx->SetParameterRange("nx>0");
+    fResponseGridCmd->SetParameter(nx);
+    G4UIparameter* ny = new G4UIparameter("ny", 'i', false);
+    ny->SetParameterRange("ny>0");
+    fResponseGridCmd->SetParameter(ny);
+    G4UIparameter* nz = new G4UIparameter("nz", 'i', false);
+    nz->SetParameterRange("nz>0");
+    fResponseGridCmd->SetParameter(nz);
+    fResponseGridCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    
+    // 慢事件统计
+    fProfilerDir = new G4UIdirectory("/nai/profiler/");
+    fProfilerDir->SetGuidance("Per-event wall time and step count profiling.");
+    
+    fProfilerCmd = new G4UIcmdWithABool("/nai/profiler/enable", this);
+    fProfilerCmd->SetGuidance("Measure wall time and steps of every event and keep the slowest ones");
+    fProfilerCmd->SetGuidance("together with their RNG state and primary vertex.");
+    fProfilerCmd->SetParameterName("enable", true);
+    fProfilerCmd->SetDefaultValue(true);
+    fProfilerCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    
+    fTopKCmd = new G4UIcmdWithAnInteger("/nai/profiler/topK", this);
+    fTopKCmd->SetGuidance("Number of slowest events kept in the table.");
+    fTopKCmd->SetParameterName("k", true);
+    fTopKCmd->SetDefaultValue(10);
+    fTopKCmd->SetRange("k>0");
+    fTopKCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    
+    // 重放慢事件
+    fReplayCmd = new G4UIcmdWithAnInteger("/run/replayEvent", this);
+    fReplayCmd->SetGuidance("Re-run one event of the slow event table with tracking verbose 1.");
+    fReplayCmd->SetGuidance("Spectra, statistics and output files are not affected.");
+    fReplayCmd->SetParameterName("eventID", false);
+    fReplayCmd->SetRange("eventID>=0");
+    fReplayCmd->AvailableForStates(G4State_Idle);
+    
+    // 峰分析
+    fAnalysisDir = new G4UIdirectory("/nai/analysis/");
+    fAnalysisDir->SetGuidance("Photopeak fit and MDA settings.");
+    
+    fNominalFWHMCmd = new G4UIcmdWithADoubleAndUnit("/nai/analysis/nominalFWHM", this);
+    fNominalFWHMCmd->SetGuidance("Nominal FWHM of the 662 keV peak.");
+    fNominalFWHMCmd->SetGuidance("The ROI is centroid +- 3 sigma with sigma not below FWHM/2.355,");
+    fNominalFWHMCmd->SetGuidance("so the MDA stays meaningful for the unbroadened simulated spectrum.");
+    fNominalFWHMCmd->SetParameterName("fwhm", false);
+    fNominalFWHMCmd->SetRange("fwhm>0.");
+    fNominalFWHMCmd->SetDefaultUnit("keV");
+    fNominalFWHMCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+}
+
+RunMessenger::~RunMessenger()
+{
+    delete fResponseMapCmd;
+    delete fResponseGridCmd;
+    delete fResponseMapDir;
+    delete fProfilerCmd;
+    delete fTopKCmd;
+    delete fReplayCmd;
+    delete fNominalFWHMCmd;
+    delete fAnalysisDir;
+    delete fProfilerDir;
+    delete fNaIDir;
+}
+
+void RunMessenger::SetNewValue(G4UIcommand* command, G4String newValue)
+{
+    if (command == fResponseMapCmd) {
+        fAction->SetResponseMapEnabled(fResponseMapCmd->GetNewBoolValue(newValue));
+    }
+    else if (command == fResponseGridCmd) {
+        G4int nx = 1, ny = 1, nz = 1;
+        std::istringstream is(newValue);
+        is >> nx >> ny >> nz;
+        fAction->SetResponseMapGrid(nx, ny, nz);
+    }
+    else if (command == fProfilerCmd) {
+        fAction->SetProfilerEnabled(fProfilerCmd->GetNewBoolValue(newValue));
+    }
+    else if (command == fTopKCmd) {
+        fAction->SetProfilerTopK(fTopKCmd->GetNewIntValue(newValue));
+    }
+    else if (command == fReplayCmd) {
+        fAction->ReplayEvent(fReplayCmd->GetNewIntValue(newValue));
+    }
+    else if (command == fNominalFWHMCmd) {
+        fAction->SetNominalFWHM(fNominalFWHMCmd->GetNewDoubleValue(newValue));
+    }
+}
@@ -0,0 +1,133 @@
+#include "SlowEventProfiler.hh"
+#include "G4SystemOfUnits.hh"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+
+namespace {
+    const G4double kMinTime = 1e-6;       // s
+    const G4int kBinsPerDecade = 20;
+    const G4int kTimeBins = 8 * kBinsPerDecade;
+    
+    // 最小堆: 堆顶为表中最快的事件
+    G4bool SlowerThan(const SlowEventRecord& a, const SlowEventRecord& b)
+    {
+        return a.wallTime > b.wallTime;
+    }
+}
+
+SlowEventProfiler::SlowEventProfiler()
+ : fTopK(10),
+   fTimeHistogram(kTimeBins, 0),
+   fNEvents(0),
+   fTotalTime(0.),
+   fMaxTime(0.)
+{}
+
+SlowEventProfiler::~SlowEventProfiler()
+{}
+
+void SlowEventProfiler::Reset()
+{
+    fSlowest.clear();
+    fTimeHistogram.assign(kTimeBins, 0);
+    fNEvents = 0;
+    fTotalTime = 0.;
+    fMaxTime = 0.;
+}
+
+G4bool SlowEventProfiler::AddEvent(G4double wallTime)
+{
+    fNEvents++;
+    fTotalTime += wallTime;
+    fMaxTime = std::max(fMaxTime, wallTime);
+    
+    G4int bin = wallTime > kMinTime
+              ? (G4int)(std::log10(wallTime / kMinTime) * kBinsPerDecade) : 0;
+    fTimeHistogram[std::min(bin, kTimeBins - 1)]++;
+    
+    if (fTopK <= 0) return false;
+    return (G4int)fSlowest.size() < fTopK || wallTime > fSlowest.front().wallTime;
+}
+
+void SlowEventProfiler::Insert(const SlowEventRecord& record)
+{
+    if ((G4int)fSlowest.size() >= fTopK) {
+        std::pop_heap(fSlowest.begin(), fSlowest.end(), SlowerThan);
+        fSlowest.pop_back();
+    }
+    fSlowest.push_back(record);
+    std::push_heap(fSlowest.begin(), fSlowest.end(), SlowerThan);
+}
+
+const SlowEventRecord* SlowEventProfiler::Find(G4int eventID) const
+{
+    for (size_t i = 0; i < fSlowest.size(); i++) {
+        if (fSlowest[i].eventID == eventID) return &fSlowest[i];
+    }
+    return 0;
+}
+
+G4double SlowEventProfiler::Percentile(G4double fraction) const
+{
+    G4long target = (G4long)std::ceil(fraction * fNEvents);
+    G4long sum = 0;
+    for (G4int i = 0; i < kTimeBins; i++) {
+        sum += fTimeHistogram[i];
+        if (sum >= target) {
+            // 返回该道上边界
+            return std::min(kMinTime * std::pow(10., (i + 1.) / kBinsPerDecade), fMaxTime);
+        }
+    }
+    return fMaxTime;
+}
+
+void SlowEventProfiler::Print() const
+{
+    if (fNEvents == 0) return;
+    
+    std::vector<SlowEventRecord> sorted(fSlowest);
+    std::sort(sorted.begin(), sorted.end(), SlowerThan);
+    
+    G4cout << G4endl
+           << "================= SLOW EVENT PROFILE ================" << G4endl
+           << " Events: " << fNEvents
+           << ", mean " << fTotalTime / fNEvents * 1e3 << " ms"
+           << ", p50 <= " << Percentile(0.50) * 1e3 << " ms"
+           << ", p99 <= " << Percentile(0.99) * 1e3 << " ms"
+           << ", max " << fMaxTime * 1e3 << " ms" << G4endl
+           << std::setw(10) << "Event" << std::setw(12) << "Time(ms)"
+           << std::setw(12) << "Steps" << "   Vertex(m) / Direction" << G4endl;
+    for (size_t i = 0; i < sorted.size(); i++) {
+        const SlowEventRecord& r = sorted[i];
+        G4cout << std::setw(10) << r.eventID
+               << std::setw(12) << r.wallTime * 1e3
+               << std::setw(12) << r.steps
+               << "   (" << r.vertex.x()/m << ", " << r.vertex.y()/m << ", " << r.vertex.z()/m << ") / ("
+               << r.direction.x() << ", " << r.direction.y() << ", " << r.direction.z() << ")" << G4endl;
+    }
+    G4cout << " Use /run/replayEvent <event> to re-run one of these with tracking verbose." << G4endl
+           << "=====================================================" << G4endl;
+}
+
+void SlowEventProfiler::Write(const G4String& fileName) const
+{
+    std::vector<SlowEventRecord> sorted(fSlowest);
+    std::sort(sorted.begin(), sorted.end(), SlowerThan);
+    
+    std::ofstream file(fileName);
+    if (!file.is_open()) return;
+    
+    file << "EventID,WallTime_ms,Steps,X_m,Y_m,Z_m,DirX,DirY,DirZ,Energy_keV,Seed1,Seed2" << std::endl;
+    file << std::setprecision(17);
+    for (size_t i = 0; i < sorted.size(); i++) {
+        const SlowEventRecord& r = sorted[i];
+        file << r.eventID << "," << r.wallTime * 1e3 << "," << r.steps << ","
+             << r.vertex.x()/m << "," << r.vertex.y()/m << "," << r.vertex.z()/m << ","
+             << r.direction.x() << "," << r.direction.y() << "," << r.direction.z() << ","
+             << r.energy/keV << "," << r.rngSeeds[0] << "," << r.rngSeeds[1] << std::endl;
+    }
+    file.close();
+    G4cout << "Slow event table saved to: " << fileName << G4endl;
+}
@@ -0,0 +1,113 @@
+#include "SourceResponseMap.hh"
+#include "G4SystemOfUnits.hh"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+SourceResponseMap::SourceResponseMap()
+ : fNx(8), fNy(5), fNz(3),
+   fSourceVolume(0.),
+   fEnergyLow(0.),
+   fEnergyInvWidth(1. / keV),
+   fEnergyBins(2000)
+{}
+
+SourceResponseMap::~SourceResponseMap()
+{}
+
+void SourceResponseMap::SetGrid(G4int nx, G4int ny, G4int nz)
+{
+    fNx = nx;
+    fNy = ny;
+    fNz = nz;
+}
+
+void SourceResponseMap::SetExtent(const G4ThreeVector& lower, const G4ThreeVector& upper)
+{
+    fLower = lower;
+    fUpper = upper;
+}
+
+void SourceResponseMap::SetEnergyBinning(G4double low, G4double high, G4int nBins)
+{
+    fEnergyLow = low;
+    fEnergyInvWidth = nBins / (high - low);
+    fEnergyBins = nBins;
+}
+
+void SourceResponseMap::Reset()
+{
+    fEmitted.assign((size_t)fNx * fNy * fNz, 0);
+    fTally.clear();
+}
+
+G4int SourceResponseMap::FindVoxel(const G4ThreeVector& pos) const
+{
+    G4int ix = (G4int)std::floor((pos.x() - fLower.x()) / (fUpper.x() - fLower.x()) * fNx);
+    G4int iy = (G4int)std::floor((pos.y() - fLower.y()) / (fUpper.y() - fLower.y()) * fNy);
+    G4int iz = (G4int)std::floor((pos.z() - fLower.z()) / (fUpper.z() - fLower.z()) * fNz);
+    if (ix < 0 || ix >= fNx || iy < 0 || iy >= fNy || iz < 0 || iz >= fNz) return -1;
+    return (iz * fNy + iy) * fNx + ix;
+}
+
+void SourceResponseMap::Record(G4int voxel, G4double edep)
+{
+    if (voxel < 0) return;
+    ++fEmitted[voxel];
+    
+    if (edep <= 0.) return;
+    G4double x = (edep - fEnergyLow) * fEnergyInvWidth;
+    if (x < 0. || x >= fEnergyBins) return;
+    ++fTally[(G4long)voxel * fEnergyBins + (G4long)x];
+}
+
+void SourceResponseMap::Write(const G4String& voxelFileName, const G4String& mapFileName) const
+{
+    G4ThreeVector size((fUpper.x() - fLower.x()) / fNx,
+                       (fUpper.y() - fLower.y()) / fNy,
+                       (fUpper.z() - fLower.z()) / fNz);
+    
+    // 体素表: 几何信息和发射数
+    std::ofstream voxelFile(voxelFileName);
+    if (voxelFile.is_open()) {
+        voxelFile << "# grid " << fNx << " " << fNy << " " << fNz << std::endl;
+        voxelFile << "# lower_m " << fLower.x()/m << " " << fLower.y()/m << " " << fLower.z()/m << std::endl;
+        voxelFile << "# upper_m " << fUpper.x()/m << " " << fUpper.y()/m << " " << fUpper.z()/m << std::endl;
+        voxelFile << "# source_volume_m3 " << fSourceVolume/m3 << std::endl;
+        voxelFile << "# energy_keV " << fEnergyLow/keV << " "
+                  << (fEnergyLow + fEnergyBins / fEnergyInvWidth)/keV << " " << fEnergyBins << std::endl;
+        voxelFile << "Voxel,IX,IY,IZ,X_m,Y_m,Z_m,Emitted" << std::endl;
+        for (G4int iz = 0; iz < fNz; iz++) {
+            for (G4int iy = 0; iy < fNy; iy++) {
+                for (G4int ix = 0; ix < fNx; ix++) {
+                    G4int voxel = (iz * fNy + iy) * fNx + ix;
+                    voxelFile << voxel << "," << ix << "," << iy << "," << iz << ","
+                              << (fLower.x() + (ix + 0.5) * size.x())/m << ","
+                              << (fLower.y() + (iy + 0.5) * size.y())/m << ","
+                              << (fLower.z() + (iz + 0.5) * size.z())/m << ","
+                              << fEmitted[voxel] << std::endl;
+                }
+            }
+        }
+        voxelFile.close();
+    }
+    
+    // 稀疏响应表, 按 (体素, 道) 排序
+    std::vector<std::pair<G4long, G4long> > entries(fTally.begin(), fTally.end());
+    std::sort(entries.begin(), entries.end());
+    
+    std::ofstream mapFile(mapFileName);
+    if (mapFile.is_open()) {
+        mapFile << "Voxel,Channel,Counts" << std::endl;
+        for (size_t i = 0; i < entries.size(); i++) {
+            mapFile << entries[i].first / fEnergyBins << ","
+                    << entries[i].first % fEnergyBins << ","
+                    << entries[i].second << std::endl;
+        }
+        mapFile.close();
+    }
+    
+    G4cout << "Source response map (" << fNx << "x" << fNy << "x" << fNz << " voxels, "
+           << entries.size() << " non-zero entries) saved to: "
+           << voxelFileName << ", " << mapFileName << G4endl;
+}
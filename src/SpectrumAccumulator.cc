@@ -0,0 +1,62 @@
+#include "SpectrumAccumulator.hh"
+#include <algorithm>
+#include <cmath>
+
+SpectrumAccumulator::SpectrumAccumulator(G4double low, G4double high, G4int nFineBins)
+ : fLow(low),
+   fWidth((high - low) / nFineBins),
+   fInvWidth(nFineBins / (high - low)),
+   fNBins(nFineBins),
+   fCounts(nFineBins, 0),
+   fUnderflow(0),
+   fOverflow(0)
+{}
+
+SpectrumAccumulator::~SpectrumAccumulator()
+{}
+
+void SpectrumAccumulator::Reset()
+{
+    fCounts.assign(fNBins, 0);
+    fUnderflow = 0;
+    fOverflow = 0;
+}
+
+std::vector<G4double> SpectrumAccumulator::GetView(G4double low, G4double high, G4int nBins,
+                                                   G4double* underflow, G4double* overflow) const
+{
+    std::vector<G4double> view(nBins, 0.);
+    if (underflow) *underflow = 0.;
+    if (overflow) *overflow = 0.;
+    
+    G4double first = (low - fLow) * fInvWidth;
+    G4double group = (high - low) / nBins * fInvWidth;
+    G4int firstFine = (G4int)std::lround(first);
+    G4int groupFine = (G4int)std::lround(group);
+    if (std::fabs(first - firstFine) > 1e-6 || std::fabs(group - groupFine) > 1e-6 || groupFine < 1) {
+        G4ExceptionDescription msg;
+        msg << "View binning [" << low << ", " << high << ") / " << nBins
+            << " is not aligned with the fine bins.";
+        G4Exception("SpectrumAccumulator::GetView()", "NaI002", JustWarning, msg);
+        return view;
+    }
+    
+    for (G4int i = 0; i < nBins; i++) {
+        G4int fine = firstFine + i * groupFine;
+        for (G4int j = fine; j < fine + groupFine; j++) {
+            if (j >= 0 && j < fNBins) view[i] += fCounts[j];
+        }
+    }
+    
+    // 视图范围以外的细分道并入溢出
+    G4int lastFine = firstFine + nBins * groupFine;
+    if (underflow) {
+        *underflow = fUnderflow;
+        for (G4int j = 0; j < std::min(firstFine, fNBins); j++) *underflow += fCounts[j];
+    }
+    if (overflow) {
+        *overflow = fOverflow;
+        for (G4int j = std::max(lastFine, 0); j < fNBins; j++) *overflow += fCounts[j];
+    }
+    return view;
+}
@@ -0,0 +1,308 @@
+#include "SpectrumAnalysis.hh"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    const G4int kNPar = 6;  // 拟合参数: 净面积N, 峰位mu, sigma, 本底b0, 本底斜率b1, 康普顿台阶高度h
+    
+    // 台阶函数 0.5·erfc(x/(√2σ)) 的原函数, 用于按道宽积分
+    G4double StepIntegral(G4double x, G4double sigma)
+    {
+        const G4double invSqrt2 = 1.0 / std::sqrt(2.0);
+        const G4double sqrt2OverPi = std::sqrt(2.0 / M_PI);
+        return 0.5 * (x * std::erfc(x / sigma * invSqrt2)
+                      - sigma * sqrt2OverPi * std::exp(-0.5 * x * x / (sigma * sigma)));
+    }
+    
+    // 对 active 参数构成的子矩阵求逆 (Gauss-Jordan, 列主元), 奇异时返回 false
+    G4bool InvertMatrix(const G4double a[kNPar][kNPar], G4double inv[kNPar][kNPar],
+                        const G4bool active[kNPar])
+    {
+        G4int idx[kNPar];
+        G4int n = 0;
+        for (G4int k = 0; k < kNPar; k++) {
+            if (active[k]) idx[n++] = k;
+        }
+        
+        G4double m[kNPar][2 * kNPar];
+        G4double scale = 0.;
+        for (G4int i = 0; i < n; i++) {
+            for (G4int j = 0; j < n; j++) {
+                m[i][j] = a[idx[i]][idx[j]];
+                m[i][n + j] = (i == j) ? 1. : 0.;
+            }
+            scale = std::max(scale, std::fabs(m[i][i]));
+        }
+        
+        for (G4int col = 0; col < n; col++) {
+            G4int pivot = col;
+            for (G4int r = col + 1; r < n; r++) {
+                if (std::fabs(m[r][col]) > std::fabs(m[pivot][col])) pivot = r;
+            }
+            if (std::fabs(m[pivot][col]) <= 1e-14 * scale) return false;
+            if (pivot != col) {
+                for (G4int j = 0; j < 2 * n; j++) std::swap(m[pivot][j], m[col][j]);
+            }
+            G4double d = m[col][col];
+            for (G4int j = 0; j < 2 * n; j++) m[col][j] /= d;
+            for (G4int r = 0; r < n; r++) {
+                if (r == col || m[r][col] == 0.) continue;
+                G4double f = m[r][col];
+                for (G4int j = 0; j < 2 * n; j++) m[r][j] -= f * m[col][j];
+            }
+        }
+        
+        for (G4int i = 0; i < kNPar; i++) {
+            for (G4int j = 0; j < kNPar; j++) inv[i][j] = 0.;
+        }
+        for (G4int i = 0; i < n; i++) {
+            for (G4int j = 0; j < n; j++) inv[idx[i]][idx[j]] = m[i][n + j];
+        }
+        return true;
+    }
+}
+
+SpectrumAnalysis::SpectrumAnalysis(const std::vector<G4double>& counts,
+                                   G4double lowEdge, G4double binWidth)
+ : fCounts(counts),
+   fLowEdge(lowEdge),
+   fBinWidth(binWidth)
+{}
+
+SpectrumAnalysis::~SpectrumAnalysis()
+{}
+
+G4int SpectrumAnalysis::FindBin(G4double energy) const
+{
+    return (G4int)std::floor((energy - fLowEdge) / fBinWidth);
+}
+
+G4double SpectrumAnalysis::Model(const G4double* par, G4double refEnergy, G4int bin) const
+{
+    // 高斯按道宽积分, 对未展宽的单道光电峰同样适用
+    const G4double invSqrt2 = 1.0 / std::sqrt(2.0);
+    G4double lo = (BinLow(bin) - par[1]) / par[2] * invSqrt2;
+    G4double hi = (BinLow(bin + 1) - par[1]) / par[2] * invSqrt2;
+    G4double gauss = 0.5 * par[0] * (std::erf(hi) - std::erf(lo));
+    return gauss + Background(par, refEnergy, bin);
+}
+
+G4double SpectrumAnalysis::Background(const G4double* par, G4double refEnergy, G4int bin) const
+{
+    // 线性本底 + 峰位处的康普顿台阶 (峰低能侧高出 h, 与峰同宽度展宽).
+    // 未展宽能谱峰以上各道为0, 没有台阶时直线会被这些道拉低
+    G4double linear = par[3] + par[4] * (BinCenter(bin) - refEnergy);
+    G4double step = par[5] * (StepIntegral(BinLow(bin + 1) - par[1], par[2])
+                              - StepIntegral(BinLow(bin) - par[1], par[2])) / fBinWidth;
+    return linear + step;
+}
+
+std::vector<G4double> SpectrumAnalysis::SearchPeaks(G4double fwhmGuess, G4double minSignificance) const
+{
+    std::vector<G4double> peaks;
+    G4int nBins = (G4int)fCounts.size();
+    G4int width = std::max(1, (G4int)std::lround(fwhmGuess / fBinWidth));
+    
+    // 前缀和, 窗口求和 O(1)
+    std::vector<G4double> cumulative(nBins + 1, 0.);
+    for (G4int i = 0; i < nBins; i++) cumulative[i + 1] = cumulative[i] + fCounts[i];
+    
+    // 中心窗口分别与左右相邻窗口比较, 取两侧显著性的较小值;
+    // 台阶 (如康普顿边) 只高于一侧, 不会被识别为峰
+    std::vector<G4double> significance(nBins, 0.);
+    for (G4int i = 0; i < nBins; i++) {
+        G4int c0 = i - width / 2;
+        G4int c1 = c0 + width;
+        if (c0 - width < 0 || c1 + width > nBins) continue;
+        G4double center = cumulative[c1] - cumulative[c0];
+        G4double left = cumulative[c0] - cumulative[c0 - width];
+        G4double right = cumulative[c1 + width] - cumulative[c1];
+        if (center <= left || center <= right) continue;
+        significance[i] = std::min((center - left) / std::sqrt(center + left),
+                                   (center - right) / std::sqrt(center + right));
+    }
+    
+    for (G4int i = 1; i + 1 < nBins; i++) {
+        if (significance[i] >= minSignificance &&
+            significance[i] >= significance[i - 1] &&
+            significance[i] > significance[i + 1]) {
+            // 峰位取中心窗口内计数最大的道
+            G4int c0 = i - width / 2;
+            G4int best = c0;
+            for (G4int j = c0; j < c0 + width; j++) {
+                if (fCounts[j] > fCounts[best]) best = j;
+            }
+            if (peaks.empty() || peaks.back() != BinCenter(best)) {
+                peaks.push_back(BinCenter(best));
+            }
+        }
+    }
+    return peaks;
+}
+
+PeakFitResult SpectrumAnalysis::FitPeak(G4double energy, G4double halfWindow, G4double minRoiSigma) const
+{
+    PeakFitResult result = PeakFitResult();
+    G4int nBins = (G4int)fCounts.size();
+    G4int first = std::max(0, FindBin(energy - halfWindow));
+    G4int last = std::min(nBins - 1, FindBin(energy + halfWindow));
+    G4int nFit = last - first + 1;
+    if (nFit < 2 * kNPar) return result;
+    
+    // 初值: 本底取窗口两端各3道均值, 峰位取最大计数道, 宽度取半高宽
+    G4double left = (fCounts[first] + fCounts[first + 1] + fCounts[first + 2]) / 3.;
+    G4double right = (fCounts[last] + fCounts[last - 1] + fCounts[last - 2]) / 3.;
+    G4int peakBin = first;
+    for (G4int i = first; i <= last; i++) {
+        if (fCounts[i] > fCounts[peakBin]) peakBin = i;
+    }
+    
+    G4double par[kNPar];
+    par[3] = right;
+    par[4] = 0.;
+    par[5] = std::max(left - right, 0.);
+    par[1] = BinCenter(peakBin);
+    
+    G4double halfMax = 0.5 * (fCounts[peakBin] + 0.5 * (left + right));
+    G4int lo = peakBin, hi = peakBin;
+    while (lo > first && fCounts[lo - 1] > halfMax) lo--;
+    while (hi < last && fCounts[hi + 1] > halfMax) hi++;
+    par[2] = (hi - lo + 1) * fBinWidth / 2.355;
+    
+    par[0] = 0.;
+    for (G4int i = first; i <= last; i++) {
+        par[0] += fCounts[i] - Background(par, energy, i);
+    }
+    par[0] = std::max(par[0], 1.);
+    
+    const G4double sigmaMin = 0.05 * fBinWidth;
+    
+    // Neyman chi2, 方差取 max(计数, 1)
+    auto chi2Of = [&](const G4double* p) {
+        G4double sum = 0.;
+        for (G4int i = first; i <= last; i++) {
+            G4double r = fCounts[i] - Model(p, energy, i);
+            sum += r * r / std::max(fCounts[i], 1.);
+        }
+        return sum;
+    };
+    
+    // 数值雅可比构造正规方程 alpha·δ = beta
+    G4double alpha[kNPar][kNPar], beta[kNPar];
+    auto buildNormal = [&](const G4double* p) {
+        G4double step[kNPar] = { 1e-3 * std::max(std::fabs(p[0]), 1.),
+                                 1e-3 * fBinWidth,
+                                 1e-3 * std::max(p[2], fBinWidth),
+                                 1e-3 * std::max(std::fabs(p[3]), 1.),
+                                 1e-3 * std::max(std::fabs(p[4]), 1e-3),
+                                 1e-3 * std::max(std::fabs(p[5]), 1.) };
+        for (G4int j = 0; j < kNPar; j++) {
+            beta[j] = 0.;
+            for (G4int k = 0; k < kNPar; k++) alpha[j][k] = 0.;
+        }
+        for (G4int i = first; i <= last; i++) {
+            G4double weight = 1.0 / std::max(fCounts[i], 1.);
+            G4double f0 = Model(p, energy, i);
+            G4double deriv[kNPar];
+            for (G4int k = 0; k < kNPar; k++) {
+                G4double shifted[kNPar];
+                std::copy(p, p + kNPar, shifted);
+                shifted[k] += step[k];
+                deriv[k] = (Model(shifted, energy, i) - f0) / step[k];
+            }
+            for (G4int j = 0; j < kNPar; j++) {
+                beta[j] += weight * deriv[j] * (fCounts[i] - f0);
+                for (G4int k = 0; k < kNPar; k++) alpha[j][k] += weight * deriv[j] * deriv[k];
+            }
+        }
+    };
+    
+    const G4bool allActive[kNPar] = { true, true, true, true, true, true };
+    G4double chi2 = chi2Of(par);
+    G4double lambda = 1e-3;
+    G4bool converged = false;
+    
+    for (G4int iter = 0; iter < 200 && !converged; iter++) {
+        buildNormal(par);
+        G4bool improved = false;
+        G4double previous = chi2;
+        
+        while (lambda < 1e10) {
+            G4double damped[kNPar][kNPar], inv[kNPar][kNPar];
+            for (G4int j = 0; j < kNPar; j++) {
+                for (G4int k = 0; k < kNPar; k++) damped[j][k] = alpha[j][k];
+                damped[j][j] *= (1. + lambda);
+            }
+            if (!InvertMatrix(damped, inv, allActive)) {
+                lambda *= 10.;
+                continue;
+            }
+            
+            G4double trial[kNPar];
+            for (G4int j = 0; j < kNPar; j++) {
+                trial[j] = par[j];
+                for (G4int k = 0; k < kNPar; k++) trial[j] += inv[j][k] * beta[k];
+            }
+            trial[2] = std::max(trial[2], sigmaMin);
+            
+            G4double trialChi2 = chi2Of(trial);
+            if (trialChi2 <= chi2) {
+                std::copy(trial, trial + kNPar, par);
+                chi2 = trialChi2;
+                lambda = std::max(lambda / 10., 1e-12);
+                improved = true;
+                break;
+            }
+            lambda *= 10.;
+        }
+        
+        // 无法继续下降或下降量可忽略即视为收敛
+        if (!improved || previous - chi2 < 1e-8 * (chi2 + 1.)) converged = true;
+    }
+    
+    // 协方差: sigma 小于半道宽 (未展宽峰) 时峰位和宽度在道内不可分辨, 二者固定;
+    // 矩阵仍奇异时同样处理
+    buildNormal(par);
+    G4double cov[kNPar][kNPar] = {};
+    G4bool resolved = par[2] >= 0.5 * fBinWidth;
+    G4bool active[kNPar] = { true, resolved, resolved, true, true, true };
+    if (!InvertMatrix(alpha, cov, active)) {
+        active[1] = false;
+        active[2] = false;
+        if (!InvertMatrix(alpha, cov, active)) converged = false;
+    }
+    G4int nFree = 0;
+    for (G4int k = 0; k < kNPar; k++) {
+        if (active[k]) nFree++;
+    }
+    
+    result.converged = converged;
+    result.netArea = par[0];
+    result.netAreaError = std::sqrt(std::max(cov[0][0], 0.));
+    result.centroid = par[1];
+    result.centroidError = std::sqrt(std::max(cov[1][1], 0.));
+    if (!active[1]) result.centroidError = fBinWidth / std::sqrt(12.);  // 峰位固定: 取道宽限制
+    result.sigma = par[2];
+    result.sigmaError = std::sqrt(std::max(cov[2][2], 0.));
+    result.sigmaAtLimit = !resolved;
+    result.roiSigma = std::max(par[2], minRoiSigma);
+    result.chi2 = chi2;
+    result.ndf = nFit - nFree;
+    
+    // ROI: centroid ± 3σ, 至少包含峰位所在道
+    G4int roiFirst = std::max(first, FindBin(par[1] - 3. * result.roiSigma));
+    G4int roiLast = std::min(last, FindBin(par[1] + 3. * result.roiSigma));
+    result.roiLow = BinLow(roiFirst);
+    result.roiHigh = BinLow(roiLast + 1);
+    for (G4int i = roiFirst; i <= roiLast; i++) {
+        result.grossCounts += fCounts[i];
+        result.backgroundCounts += std::max(Background(par, energy, i), 0.);
+    }
+    
+    return result;
+}
+
+G4double SpectrumAnalysis::DetectionLimit(G4double backgroundCounts)
+{
+    return 2.71 + 4.65 * std::sqrt(std::max(backgroundCounts, 0.));
+}
@@ -6,10 +6,12 @@
 #include "G4StepPoint.hh"
 #include "G4VPhysicalVolume.hh"
 #include "G4LogicalVolume.hh"
+#include "G4LogicalVolumeStore.hh"
 #include "G4SystemOfUnits.hh"
 
 SteppingAction::SteppingAction(EventAction* eventAction)
- : fEventAction(eventAction)
+ : fEventAction(eventAction),
+   fCrystalLog(0)
 {}
 
 SteppingAction::~SteppingAction()
@@ -17,16 +19,22 @@ SteppingAction::~SteppingAction()
 
 void SteppingAction::UserSteppingAction(const G4Step* step)
 {
+    fEventAction->CountStep();
+    
     // 获取步长所在的物理体积
     G4VPhysicalVolume* preVolume = step->GetPreStepPoint()->GetPhysicalVolume();
     
     if (!preVolume) return;
     
+    // 复杂房间中大部分步长不在晶体内, 用指针比较代替名字比较
+    if (!fCrystalLog) {
+        fCrystalLog = G4LogicalVolumeStore::GetInstance()->GetVolume("NaICrystal", false);
+    }
+    
     // 检查是否在NaI晶体中
     G4LogicalVolume* preLogical = preVolume->GetLogicalVolume();
-    G4String volumeName = preLogical->GetName();
     
-    if (volumeName == "NaICrystal") {
+    if (preLogical == fCrystalLog) {
         // 在NaI晶体中的能量沉积
         G4double edep = step->GetTotalEnergyDeposit();
         if (edep > 0.) {
@@ -3,6 +3,8 @@
 #include "G4VisExecutive.hh"
 #include "G4UIExecutive.hh"
 #include "Randomize.hh"
+#include <cerrno>
+#include <cstdlib>
 
 #include "DetectorConstruction.hh"
 #include "PhysicsList.hh"
@@ -13,10 +15,23 @@
 
 int main(int argc, char** argv)
 {
-    // 设置随机数种子
+    // 设置随机数种子: 默认取当前时间, 环境变量 NAI_SEED 可指定种子以复现整个运行
     G4Random::setTheEngine(new CLHEP::RanecuEngine);
     G4long seed = time(NULL);
+    const char* seedEnv = std::getenv("NAI_SEED");
+    if (seedEnv && *seedEnv) {
+        char* end = 0;
+        errno = 0;
+        G4long value = std::strtol(seedEnv, &end, 10);
+        if (errno == 0 && *end == '\0') {
+            seed = value;
+        } else {
+            G4cout << "WARNING: NAI_SEED=\"" << seedEnv
+                   << "\" is not an integer, using time-based seed" << G4endl;
+        }
+    }
     G4Random::setTheSeed(seed);
+    G4cout << "Random seed: " << seed << " (rerun with NAI_SEED=" << seed << " to reproduce)" << G4endl;
     
     // 创建运行管理器
     G4RunManager* runManager = new G4RunManager;
@@ -44,8 +59,8 @@ int main(int argc, char** argv)
     PrimaryGeneratorAction* primaryGenerator = new PrimaryGeneratorAction;
     runManager->SetUserAction(primaryGenerator);
     
-    // 初始化Geant4内核
-    runManager->Initialize();
+    // Geant4内核由宏文件中的 /run/initialize 初始化,
+    // 以便 /det/ 几何命令 (如GDML房间文件) 在PreInit状态下生效
     
     // 可视化管理器
     G4VisManager* visManager = new G4VisExecutive;